@@ -4,14 +4,47 @@
 #include <iostream>
 #include <memory>
 #include <algorithm>
+#include <functional>
 #include "basic_exp.h"
+#include "bytecode.h"
+#include "substitution.h"
 
 class BaseAST {
 public:
-    static BasicExp resultExp;
+    static thread_local BasicExp resultExp;    // per thread, so that sessions can run in parallel
+    static thread_local bool memoize;    // reuse and record per-node results of calc(), see IncrementalSession
+    uint32_t tokBegin {0};  // first token of this node in the token stream
+    uint32_t tokEnd {0};    // one past the last token of this node
     virtual ~BaseAST() = default;
     virtual void Dump(std::string indent) const = 0;
     virtual void calc() const = 0;    // TODO: implement this method on every ast nodes
+    virtual void compile(Program &prog) const = 0;    // emits what calc() computes, see bytecode.h
+    virtual void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) = 0;
+    void invalidate() {_memoValid = false;}
+
+protected:
+    // only nodes whose result does not depend on the incoming resultExp are memoized,
+    // i.e. not the Exprs/Terms/Symb0 tails which fold into the left operand
+    mutable std::unique_ptr<BasicExp> _memo;   // allocated by the first storeMemo(), nodes stay small
+    mutable bool _memoValid {false};
+
+    bool loadMemo() const {
+        if (memoize && _memoValid) {
+            resultExp = *_memo;
+            return true;
+        }
+        return false;
+    }
+
+    void storeMemo() const {
+        if (memoize) {
+            if (!_memo) {
+                _memo.reset(new BasicExp());
+            }
+            *_memo = resultExp;
+            _memoValid = true;
+        }
+    }
 };
 
 class ExprAST : public BaseAST{
@@ -26,8 +59,22 @@ public:
     }
 
     void calc() const override{
+        if (loadMemo()) {
+            return;
+        }
         term->calc();
         exprs->calc();
+        storeMemo();
+    }
+
+    void compile(Program &prog) const override{
+        term->compile(prog);
+        exprs->compile(prog);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        fn(term);
+        fn(exprs);
     }
 };
 
@@ -55,7 +102,7 @@ public:
         if (type == -1) {
             return;
         }
-        BasicExp tmp = resultExp;
+        BasicExp tmp = std::move(resultExp);
         term->calc();
         if (type == 0) {
             resultExp = tmp + resultExp;
@@ -64,6 +111,23 @@ public:
         }
         exprs->calc();
     }
+
+    void compile(Program &prog) const override{
+        if (type == -1) {
+            return;
+        }
+        term->compile(prog);
+        prog.emit(type == 0 ? OpCode::Add : OpCode::Sub);
+        exprs->compile(prog);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        if (type == -1) {
+            return;
+        }
+        fn(term);
+        fn(exprs);
+    }
 };
 
 class TermAST : public BaseAST{
@@ -78,8 +142,22 @@ public:
     }
 
     void calc() const override{
+        if (loadMemo()) {
+            return;
+        }
         uExpr->calc();
         terms->calc();
+        storeMemo();
+    }
+
+    void compile(Program &prog) const override{
+        uExpr->compile(prog);
+        terms->compile(prog);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        fn(uExpr);
+        fn(terms);
     }
 };
 
@@ -107,7 +185,7 @@ public:
         if (type == -1) {
             return;
         }
-        BasicExp tmp = resultExp;
+        BasicExp tmp = std::move(resultExp);
         uExpr->calc();
         if (type == 0) {
             resultExp = tmp * resultExp;
@@ -116,6 +194,23 @@ public:
         }
         terms->calc();
     }
+
+    void compile(Program &prog) const override{
+        if (type == -1) {
+            return;
+        }
+        uExpr->compile(prog);
+        prog.emit(type == 0 ? OpCode::Mul : OpCode::Div);
+        terms->compile(prog);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        if (type == -1) {
+            return;
+        }
+        fn(uExpr);
+        fn(terms);
+    }
 };
 
 class UExprAST : public BaseAST{
@@ -134,10 +229,25 @@ public:
     }
 
     void calc() const override{
+        if (loadMemo()) {
+            return;
+        }
         fact->calc();
         if (type == 1) {
             resultExp = -resultExp;
         }
+        storeMemo();
+    }
+
+    void compile(Program &prog) const override{
+        fact->compile(prog);
+        if (type == 1) {
+            prog.emit(OpCode::Neg);
+        }
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        fn(fact);
     }
 };
 
@@ -165,6 +275,9 @@ public:
     }
 
     void calc() const override{
+        if (loadMemo()) {
+            return;
+        }
         if (type == 0) {
             expr->calc();
         } else if (type == 1) {
@@ -173,6 +286,29 @@ public:
         } else {
             symbs->calc();
         }
+        storeMemo();
+    }
+
+    void compile(Program &prog) const override{
+        if (type == 0) {
+            expr->compile(prog);
+        } else if (type == 1) {
+            num->compile(prog);
+            symb0->compile(prog);
+        } else {
+            symbs->compile(prog);
+        }
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        if (type == 0) {
+            fn(expr);
+        } else if (type == 1) {
+            fn(num);
+            fn(symb0);
+        } else {
+            fn(symbs);
+        }
     }
 };
 
@@ -195,19 +331,29 @@ public:
         if (type == 0) {
             frac->calc();
         } else {
-            std::vector<BasicTerm>().swap(resultExp.numer);
-            resultExp.numer.push_back(BasicTerm(Rational(number, 1), 0));
+            resultExp.numer.clear();
+            resultExp.numer.push_back(BasicTerm(Rational(number, 1), Monomial()));
+        }
+    }
+
+    void compile(Program &prog) const override{
+        if (type == 0) {
+            frac->compile(prog);
+        } else {
+            prog.emit(OpCode::PushNum, number);
+        }
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        if (type == 0) {
+            fn(frac);
         }
     }
 };
 
 class SymbsAST : public BaseAST{
 private:
-    const std::vector<std::string> _symbolPool {
-        "\\alpha", "\\beta", "\\gamma", "\\delta", "\\epsilon", "\\zeta", "\\eta", "\\theta", "\\lota", "\\kappa",
-        "\\lambda", "\\mu", "\\nu", "\\xi", "\\omicron", "\\pi", "\\rho", "\\sigma", "\\tau", "\\upsilon", "\\phi",
-        "\\chi", "\\psi", "\\omega",
-    };  // 24
+    mutable int _id {-1};   // interned on first use
 
 public:
     std::string symbol;
@@ -219,18 +365,33 @@ public:
         symb0->Dump(indent + "  ");
     }
 
+    // id of the symbol in SymbolTable::global(), a = 0, \alpha = 26
+    uint32_t symbolIndex() const {
+        if (_id < 0) {
+            _id = SymbolTable::global().intern(symbol);
+        }
+        return _id;
+    }
+
     void calc() const override{
-        uint64_t symbolBit;
-        if (symbol.length() == 1) {
-            symbolBit = 1ULL << (symbol[0] - 'a');
+        const BasicExp *value = boundValue(symbolIndex());   // see substitution.h
+        if (value != nullptr) {
+            resultExp = *value;
         } else {
-            std::vector<std::string>::const_iterator it = find(_symbolPool.begin(), _symbolPool.end(), symbol);
-            symbolBit = 1ULL << (26 + it - _symbolPool.begin());
+            resultExp.numer.clear();
+            resultExp.numer.push_back(BasicTerm(Rational(1, 1), Monomial::symbol(symbolIndex())));
         }
-        std::vector<BasicTerm>().swap(resultExp.numer);
-        resultExp.numer.push_back(BasicTerm(Rational(1, 1), symbolBit));
         symb0->calc();
     }
+
+    void compile(Program &prog) const override{
+        prog.emit(OpCode::PushSym, symbolIndex());
+        symb0->compile(prog);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        fn(symb0);
+    }
 };
 
 class Symb0AST : public BaseAST{
@@ -250,10 +411,25 @@ public:
         if (type == -1) {
             return;
         }
-        BasicExp tmp = resultExp;
+        BasicExp tmp = std::move(resultExp);
         symbs->calc();
         resultExp = tmp * resultExp;
     }
+
+    void compile(Program &prog) const override{
+        if (type == -1) {
+            return;
+        }
+        symbs->compile(prog);
+        prog.emit(OpCode::Mul);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        if (type == -1) {
+            return;
+        }
+        fn(symbs);
+    }
 };
 
 class FracAST : public BaseAST{
@@ -273,10 +449,25 @@ public:
     }
 
     void calc() const override{
+        if (loadMemo()) {
+            return;
+        }
         expr_numer->calc();
-        BasicExp tmp = resultExp;
+        BasicExp tmp = std::move(resultExp);
         expr_denom->calc();
         resultExp = tmp / resultExp;
+        storeMemo();
+    }
+
+    void compile(Program &prog) const override{
+        expr_numer->compile(prog);
+        expr_denom->compile(prog);
+        prog.emit(OpCode::Div);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        fn(expr_numer);
+        fn(expr_denom);
     }
 };
 
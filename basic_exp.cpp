@@ -1,17 +1,21 @@
 #include "basic_exp.h"
 #include "utils.h"
+#include "budget.h"
 #include <cstdio>
+#include <vector>
 
+// the numerators and denominators are computed in 64 bits and checked against the budget,
+// so an overflow of the int is an error if the budget forbids it
 Rational operator+(const Rational& ratA, const Rational& ratB)
 {
     if (ratA.denom == 1 && ratB.denom == 1) {
-        return Rational(ratA.numer + ratB.numer, 1);
+        return Rational(checkCoefficient(int64_t(ratA.numer) + ratB.numer), 1);
     }
-    int numer = ratA.numer * ratB.denom + ratA.denom * ratB.numer;
+    int numer = checkCoefficient(int64_t(ratA.numer) * ratB.denom + int64_t(ratA.denom) * ratB.numer);
     if (numer == 0) {
         return Rational(0, 1);
     }
-    int denom = ratA.denom * ratB.denom;
+    int denom = checkCoefficient(int64_t(ratA.denom) * ratB.denom);
     int gcd = Gcd({numer, denom});
     return Rational(numer / gcd, denom / gcd);
 }
@@ -19,13 +23,13 @@ Rational operator+(const Rational& ratA, const Rational& ratB)
 Rational operator-(const Rational& ratA, const Rational& ratB)
 {
     if (ratA.denom == 1 && ratB.denom == 1) {
-        return Rational(ratA.numer - ratB.numer, 1);
+        return Rational(checkCoefficient(int64_t(ratA.numer) - ratB.numer), 1);
     }
-    int numer = ratA.numer * ratB.denom - ratA.denom * ratB.numer;
+    int numer = checkCoefficient(int64_t(ratA.numer) * ratB.denom - int64_t(ratA.denom) * ratB.numer);
     if (numer == 0) {
         return Rational(0, 1);
     }
-    int denom = ratA.denom * ratB.denom;
+    int denom = checkCoefficient(int64_t(ratA.denom) * ratB.denom);
     int gcd = Gcd({numer, denom});
     return Rational(numer / gcd, denom / gcd);
 }
@@ -33,13 +37,13 @@ Rational operator-(const Rational& ratA, const Rational& ratB)
 Rational operator*(const Rational& ratA, const Rational& ratB)
 {
     if (ratA.denom == 1 && ratB.denom == 1) {
-        return Rational(ratA.numer * ratB.numer, 1);
+        return Rational(checkCoefficient(int64_t(ratA.numer) * ratB.numer), 1);
     }
     if (ratA.denom == 0 || ratB.denom == 0) {
         return Rational(0, 1);
     }
-    int numer = ratA.numer * ratB.numer;    // may have overflow problem, could be optimized
-    int denom = ratA.denom * ratB.denom;
+    int numer = checkCoefficient(int64_t(ratA.numer) * ratB.numer);
+    int denom = checkCoefficient(int64_t(ratA.denom) * ratB.denom);
     int gcd = Gcd({numer, denom});
     return Rational(numer / gcd, denom / gcd);
 }
@@ -49,23 +53,28 @@ Rational operator/(const Rational& ratA, const Rational& ratB)
     if (ratA.denom == 0) {
         return Rational(0, 1);
     }
-    int numer = ratA.numer * ratB.denom;    // may have overflow problem, could be optimized
-    int denom = ratA.denom * ratB.numer;
+    int numer = checkCoefficient(int64_t(ratA.numer) * ratB.denom);
+    if (numer == 0) {
+        return Rational(0, 1);  // also 0/0, which has no gcd
+    }
+    int denom = checkCoefficient(int64_t(ratA.denom) * ratB.numer);
     int gcd = Gcd({numer, denom});
     return Rational(numer / gcd, denom / gcd);
 }
 
 BasicTerm operator-(const BasicTerm& term)
 {
-    return BasicTerm(Rational(-term.rational.numer, term.rational.denom), term.symbolTable);
+    return BasicTerm(Rational(-term.rational.numer, term.rational.denom), term.monomial);
 }
 
 BasicTerm operator*(const BasicTerm& termA, const BasicTerm& termB)
 {
     // same symbols are not allowed to multiply, e.g. a*a
-    assert("no same symbols allowed in multiply" && (termA.symbolTable & termB.symbolTable) == 0);
+    if (!termA.monomial.disjoint(termB.monomial)) {
+        throw UnsupportedOperation();
+    }
 
-    return BasicTerm(termA.rational * termB.rational, termA.symbolTable | termB.symbolTable);
+    return BasicTerm(termA.rational * termB.rational, termA.monomial | termB.monomial);
 }
 
 BasicExp operator-(const BasicExp& exp)
@@ -79,16 +88,121 @@ BasicExp operator-(const BasicExp& exp)
     return res;
 }
 
+/* Expressions of a few symbols with many of the monomials over them: every monomial is a
+ * subset of the k symbols, i.e. an index below 2^k, so a term of expB finds its match in
+ * expA by one array lookup instead of a scan over expA. The array holds the position of
+ * the monomial in expA, -1 if there is none, and is reset after every use, exceptions
+ * included (DenseReset), so it costs nothing as long as it is not grown. The terms end up
+ * where the scan puts them.
+ */
+class DenseIndex {
+public:
+    static constexpr uint32_t MaxSymbols = 16;
+    static constexpr uint32_t MinWork = 256;    // lenA * lenB, below that the scan is cheaper
+    static constexpr uint32_t Density = 16;     // 2^k <= Density * (lenA + lenB)
+
+    bool init(const BasicExp &expA, const BasicExp &expB);
+
+    uint32_t operator()(const Monomial &mono) const {
+        uint32_t index = 0;
+        for (uint64_t rest = mono.word(0); rest != 0; rest &= rest - 1) {
+            index |= 1u << _rank[__builtin_ctzll(rest)];
+        }
+        return index;
+    }
+
+    uint32_t size() const {return 1u << _symbols;}
+
+private:
+    uint8_t _rank[64];
+    uint32_t _symbols;
+};
+
+static thread_local std::vector<int32_t> densePos;
+
+// false if the expressions are too small, have too many symbols or too few of their monomials
+bool DenseIndex::init(const BasicExp &expA, const BasicExp &expB)
+{
+    size_t lenA = expA.numer.size(), lenB = expB.numer.size();
+    if (lenA * lenB < MinWork) {
+        return false;
+    }
+    uint64_t used = 0;
+    for (const BasicExp *exp : {&expA, &expB}) {
+        for (const BasicTerm &term : exp->numer) {
+            if (!term.monomial.isDense()) {
+                return false;
+            }
+            used |= term.monomial.word(0);
+        }
+    }
+    _symbols = __builtin_popcountll(used);
+    if (_symbols > MaxSymbols || size() > Density * (lenA + lenB)) {
+        return false;
+    }
+    uint32_t rank = 0;
+    for (uint64_t rest = used; rest != 0; rest &= rest - 1) {
+        _rank[__builtin_ctzll(rest)] = rank++;
+    }
+    if (densePos.size() < size()) {
+        densePos.resize(size(), -1);
+    }
+    return true;
+}
+
+// clears the positions of expA again, also if a budget or the allocator throws in the add
+struct DenseReset {
+    const DenseIndex &index;
+    const BasicExp &expA;
+
+    ~DenseReset() {
+        for (const BasicTerm &term : expA.numer) {
+            densePos[index(term.monomial)] = -1;
+        }
+    }
+};
+
+// expA + expB (or expA - expB) into res if they are dense, the first match in expA counts
+static bool denseAdd(const BasicExp &expA, const BasicExp &expB, bool subtract, BasicExp &res)
+{
+    DenseIndex index;
+    if (!index.init(expA, expB)) {
+        return false;
+    }
+    int lenA = expA.numer.size();
+    res = expA;
+    DenseReset reset {index, expA};
+    for (int i = lenA; i-- > 0; ) {
+        densePos[index(expA.numer[i].monomial)] = i;
+    }
+    for (const BasicTerm &term : expB.numer) {
+        int32_t i = densePos[index(term.monomial)];
+        if (i >= 0) {
+            res.numer[i].rational = subtract ? expA.numer[i].rational - term.rational : expA.numer[i].rational + term.rational;
+        } else {
+            res.numer.push_back(subtract ? -term : term);
+        }
+    }
+    return true;
+}
+
 BasicExp operator+(const BasicExp& expA, const BasicExp& expB)
 {
-    BasicExp res = expA;
+    BasicExp res;
+    checkDeadline(expA.numer.size() + expB.numer.size());
+    if (denseAdd(expA, expB, false, res)) {
+        checkTerms(res.numer.size());
+        return res;
+    }
+    res = expA;
     int lenA = expA.numer.size();
     int lenB = expB.numer.size();
 
     for (int j = 0; j < lenB; ++j) {
+        checkDeadline(lenA);
         int i = 0;
         for ( ; i < lenA; ++i) {
-            if (expA.numer[i].symbolTable == expB.numer[j].symbolTable) {
+            if (expA.numer[i].monomial == expB.numer[j].monomial) {
                 res.numer[i].rational = expA.numer[i].rational + expB.numer[j].rational;
                 break;
             }
@@ -97,19 +211,27 @@ BasicExp operator+(const BasicExp& expA, const BasicExp& expB)
             res.numer.push_back(expB.numer[j]);
         }
     }
+    checkTerms(res.numer.size());
     return res;
 }
 
 BasicExp operator-(const BasicExp& expA, const BasicExp& expB)
 {
-    BasicExp res = expA;
+    BasicExp res;
+    checkDeadline(expA.numer.size() + expB.numer.size());
+    if (denseAdd(expA, expB, true, res)) {
+        checkTerms(res.numer.size());
+        return res;
+    }
+    res = expA;
     int lenA = expA.numer.size();
     int lenB = expB.numer.size();
 
     for (int j = 0; j < lenB; ++j) {
+        checkDeadline(lenA);
         int i = 0;
         for ( ; i < lenA; ++i) {
-            if (expA.numer[i].symbolTable == expB.numer[j].symbolTable) {
+            if (expA.numer[i].monomial == expB.numer[j].monomial) {
                 res.numer[i].rational = expA.numer[i].rational - expB.numer[j].rational;
                 break;
             }
@@ -118,16 +240,22 @@ BasicExp operator-(const BasicExp& expA, const BasicExp& expB)
             res.numer.push_back(-expB.numer[j]);
         }
     }
+    checkTerms(res.numer.size());
     return res;
 }
 
+// the products of square-free monomials never coincide (a common symbol would be squared),
+// so there is nothing to look up and the terms are only appended
 BasicExp operator*(const BasicExp& expA, const BasicExp& expB)
 {
     BasicExp res;
     int lenA = expA.numer.size();
     int lenB = expB.numer.size();
 
+    checkTerms(size_t(lenA) * lenB);    // before the terms are allocated
+
     for (int i = 0; i < lenA; ++i) {
+        checkDeadline(lenB);
         for (int j = 0; j < lenB; ++j) {
             res.numer.push_back(expA.numer[i] * expB.numer[j]);
         }
@@ -142,10 +270,162 @@ BasicExp operator/(const BasicExp& expA, const BasicExp& expB)
     int lenB = expB.numer.size();
 
     // we only support devision when no symbol in expB
-    assert ("no symbols allowed in devisor" && lenB == 1 && expB.numer[0].symbolTable == 0);
+    if (lenB != 1 || !expB.numer[0].monomial.empty()) {
+        throw UnsupportedOperation();
+    }
 
     for (int i = 0; i < lenA; ++i) {
         res.numer[i].rational = expA.numer[i].rational / expB.numer[0].rational;
     }
     return res;
 }
+
+// one stable counting sort pass of keys by digit(key) < buckets, skipped if all digits are equal
+template <typename Key, typename Digit>
+static void countingPass(std::vector<Key> &keys, std::vector<Key> &tmp, std::vector<uint32_t> &count,
+                         uint32_t buckets, Digit digit)
+{
+    count.assign(buckets + 1, 0);
+    for (const Key &key : keys) {
+        count[digit(key) + 1]++;
+    }
+    if (count[digit(keys[0]) + 1] == keys.size()) {
+        return;
+    }
+    for (uint32_t b = 0; b < buckets; ++b) {
+        count[b + 1] += count[b];
+    }
+    tmp.resize(keys.size());
+    for (const Key &key : keys) {
+        tmp[count[digit(key)]++] = key;
+    }
+    keys.swap(tmp);
+}
+
+struct DenseKey {
+    uint64_t word;
+    uint32_t degree;
+    uint32_t index;
+};
+
+// scratch space of ExpSort(), kept between the calls of a thread
+struct SortBuffers {
+    std::vector<DenseKey> keys;
+    std::vector<DenseKey> keysTmp;
+    std::vector<uint32_t> idx;
+    std::vector<uint32_t> idxTmp;
+    std::vector<uint32_t> count;
+    std::vector<uint32_t> ranks;
+    std::vector<uint32_t> rankOf;
+};
+
+static thread_local SortBuffers sortBuffers;
+
+/* Small expressions are sorted by std::sort, larger ones by a LSD radix sort, followed by
+ * one pass moving the terms to their places:
+ *  - monomials of the first 64 symbols are sorted by the bytes of their word, the passes
+ *    for bytes which are the same in all of them (the high ones, usually) are skipped,
+ *  - otherwise the symbols which appear are ranked 1..k and every monomial becomes the
+ *    tuple of its ranks, highest first and padded with 0, sorted one position at a time.
+ * GradedLex adds one more pass by the degree. Either way the sort is linear in the number
+ * of terms (times the degree) and the terms are only moved, never copied.
+ */
+void BasicExp::ExpSort(MonomialOrder order)
+{
+    const size_t SmallSort = 32;
+    const uint32_t n = numer.size();
+
+    if (order == MonomialOrder::Input || n < 2) {
+        return;
+    }
+    if (n < SmallSort) {
+        if (order == MonomialOrder::Lex) {
+            std::sort(numer.begin(), numer.end(), [](const BasicTerm &termA, const BasicTerm &termB) {
+                return termA.monomial < termB.monomial;
+            });
+        } else {
+            std::sort(numer.begin(), numer.end(), [](const BasicTerm &termA, const BasicTerm &termB) {
+                uint32_t degA = termA.monomial.degree(), degB = termB.monomial.degree();
+                return degA != degB ? degA < degB : termA.monomial < termB.monomial;
+            });
+        }
+        return;
+    }
+
+    SortBuffers &buf = sortBuffers;
+    bool dense = true;
+    for (const BasicTerm &term : numer) {
+        dense = dense && term.monomial.isDense();
+    }
+
+    buf.idx.resize(n);
+    if (dense) {
+        buf.keys.resize(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            buf.keys[i] = DenseKey{numer[i].monomial.word(0), numer[i].monomial.degree(), i};
+        }
+        for (int shift = 0; shift < 64; shift += 8) {
+            countingPass(buf.keys, buf.keysTmp, buf.count, 256, [shift](const DenseKey &key) {
+                return uint32_t(key.word >> shift) & 0xff;
+            });
+        }
+        if (order == MonomialOrder::GradedLex) {
+            countingPass(buf.keys, buf.keysTmp, buf.count, 65, [](const DenseKey &key) {
+                return key.degree;
+            });
+        }
+        for (uint32_t i = 0; i < n; ++i) {
+            buf.idx[i] = buf.keys[i].index;
+        }
+    } else {
+        // rank the symbols which appear, in the order of their ids
+        uint32_t maxId = 0;
+        uint32_t maxDegree = 0;
+        for (const BasicTerm &term : numer) {
+            if (!term.monomial.empty()) {
+                maxId = std::max(maxId, term.monomial.last());
+            }
+            maxDegree = std::max(maxDegree, term.monomial.degree());
+        }
+        buf.rankOf.assign(maxId + 1, 0);
+        for (const BasicTerm &term : numer) {
+            term.monomial.forEach([&buf](uint32_t id) {
+                buf.rankOf[id] = 1;
+            });
+        }
+        uint32_t k = 0;
+        for (uint32_t &rank : buf.rankOf) {
+            rank = rank ? ++k : 0;
+        }
+
+        // one more column for the degree
+        const size_t width = maxDegree + 1;
+        buf.ranks.assign(size_t(n) * width, 0);
+        for (uint32_t i = 0; i < n; ++i) {
+            uint32_t *tuple = &buf.ranks[size_t(i) * width];
+            uint32_t pos = numer[i].monomial.degree();
+            tuple[maxDegree] = pos;
+            numer[i].monomial.forEach([&buf, tuple, &pos](uint32_t id) {
+                tuple[--pos] = buf.rankOf[id];
+            });
+            buf.idx[i] = i;
+        }
+        for (uint32_t pos = maxDegree; pos-- > 0; ) {
+            countingPass(buf.idx, buf.idxTmp, buf.count, k + 1, [&buf, width, pos](uint32_t i) {
+                return buf.ranks[size_t(i) * width + pos];
+            });
+        }
+        if (order == MonomialOrder::GradedLex) {
+            countingPass(buf.idx, buf.idxTmp, buf.count, maxDegree + 1, [&buf, width, maxDegree](uint32_t i) {
+                return buf.ranks[size_t(i) * width + maxDegree];
+            });
+        }
+    }
+
+    Terms sorted;
+    sorted.reserve(n);
+    for (uint32_t i : buf.idx) {
+        sorted.push_back(std::move(numer[i]));
+    }
+    numer.swap(sorted);
+}
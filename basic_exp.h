@@ -5,6 +5,18 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <exception>
+#include "small_vector.h"
+#include "buffer_pool.h"
+#include "monomial.h"
+#include "symbol_table.h"
+
+// a product with a symbol on both sides (a*a) or a divisor with symbols, which a BasicExp
+// cannot hold, thrown by the operators, the Session returns Error::Unsupported for it
+class UnsupportedOperation : public std::exception {
+public:
+    const char *what() const noexcept override {return "unsupported operation";}
+};
 
 class Rational {
 public:
@@ -13,80 +25,83 @@ public:
     
     Rational(int n, int d) : numer(n), denom(d) {};
 
+    // a quotient by a negative number keeps the sign in the denominator
+    bool positive() const {return denom < 0 ? numer < 0 : numer > 0;}
+
     friend Rational operator+(const Rational& ratA, const Rational& ratB);
     friend Rational operator-(const Rational& ratA, const Rational& ratB);
     friend Rational operator*(const Rational& ratA, const Rational& ratB);
     friend Rational operator/(const Rational& ratA, const Rational& ratB);
 
-    void CodeGen() {
+    void CodeGen(std::ostream &os = std::cout) {
         if (denom < 0) {
             denom *= -1;
             numer *= -1;
         }
         if (numer < 0) { // if the numerator is negative
-            std::cout << "-";
+            os << "-";
         }
-        std::cout << "\\frac{" << std::abs(numer) << "}{" << denom << "}";
+        os << "\\frac{" << std::abs(numer) << "}{" << denom << "}";
     }
 };
 
-class BasicTerm {
-private:
-    const std::vector<std::string> _symbolPool {
-        "\\alpha", "\\beta", "\\gamma", "\\delta", "\\epsilon", "\\zeta", "\\eta", "\\theta", "\\lota", "\\kappa",
-        "\\lambda", "\\mu", "\\nu", "\\xi", "\\omicron", "\\pi", "\\rho", "\\sigma", "\\tau", "\\upsilon", "\\phi",
-        "\\chi", "\\psi", "\\omega",
-    };  // 24
+// the names of the symbols of monomial, as they follow the coefficient in the output
+inline void writeSymbols(std::ostream &os, const Monomial &monomial)
+{
+    bool command = false;  // the last name was a command, "\alphax_{1}" would be another one
+    monomial.forEach([&os, &command](uint32_t id) {
+        const std::string &name = SymbolTable::global().name(id);
+        if (command && !name.empty() && name[0] != '\\') {
+            os << " ";
+        }
+        os << name;
+        command = !name.empty() && name[0] == '\\' && name.back() != '}';
+    });
+}
 
+class BasicTerm {
 public:
     Rational rational;
-    uint64_t symbolTable {0};  // bit pattern for symbols, a = 1 << 0, \alpha = 1 << 26
+    Monomial monomial;  // ids of the symbols, see symbol_table.h
 
-    BasicTerm(Rational rat, uint64_t st) : rational(rat), symbolTable(st) {};
-    BasicTerm& operator=(const BasicTerm& term) {
-        this->rational = term.rational;
-        this->symbolTable = term.symbolTable;
-        return *this;
-    }
+    BasicTerm(Rational rat, Monomial mono) : rational(rat), monomial(std::move(mono)) {};
 
     friend BasicTerm operator-(const BasicTerm& term);
     friend BasicTerm operator*(const BasicTerm& termA, const BasicTerm& termB);
 
-    void CodeGen() {
+    void CodeGen(std::ostream &os = std::cout) {
         // rational.CodeGen();
         if (rational.denom == 1) {
             if (rational.numer < 0) {
-                std::cout << "-";
+                os << "-";
             }
-            if (std::abs(rational.numer) != 1 || symbolTable == 0) {
-                std::cout << std::abs(rational.numer);
+            if (std::abs(rational.numer) != 1 || monomial.empty()) {
+                os << std::abs(rational.numer);
             }
         } else {
-            rational.CodeGen();
-        }
-        for (char c = 'a'; c <= 'z'; ++c) {
-            if (symbolTable & (1ULL << (c - 'a'))) {
-                std::cout << c;
-            }
-        }
-        for (int i = 0; i < 24; ++i) {
-            if (symbolTable & (1ULL << (26 + i))) {
-                std::cout << _symbolPool[i];
-            }
+            rational.CodeGen(os);
         }
+        writeSymbols(os, monomial);
     }
 };
 
+// orders of the terms after BasicExp::ExpSort()
+enum class MonomialOrder : uint32_t {
+    Lex,        // by the highest symbol only one of two monomials has, constants first
+    GradedLex,  // by the number of symbols first, then Lex
+    Input,      // in the order the monomials first appeared, i.e. not sorted
+};
+
 class BasicExp {
 public:
-    std::vector<BasicTerm> numer;   // in case the exp is a frac-style exp, i.e. there are symbols in denom
+    // most intermediate results have a few terms only, they stay off the heap
+    static constexpr size_t InlineTerms = 4;
+    typedef SmallVector<BasicTerm, InlineTerms, BufferPool> Terms;   // larger ones recycle their buffers
+
+    Terms numer;   // in case the exp is a frac-style exp, i.e. there are symbols in denom
     // std::vector<BasicTerm> denom;
 
     BasicExp() {};
-    BasicExp& operator=(const BasicExp& exp) {
-        this->numer = exp.numer;
-        return *this;
-    }
 
     friend BasicExp operator-(const BasicExp& exp);
     friend BasicExp operator+(const BasicExp& expA, const BasicExp& expB);
@@ -94,23 +109,19 @@ public:
     friend BasicExp operator*(const BasicExp& expA, const BasicExp& expB);
     friend BasicExp operator/(const BasicExp& expA, const BasicExp& expB);
 
-    void CodeGen() {
+    void CodeGen(std::ostream &os = std::cout) {
         int len = numer.size();
         for (int i = 0; i < len; ++i) {
             if (i > 0) {
-                if (numer[i].rational.numer > 0) {
-                    std::cout << "+";
+                if (numer[i].rational.positive()) {
+                    os << "+";
                 }
             }
-            numer[i].CodeGen();
+            numer[i].CodeGen(os);
         }
     }
 
-    void ExpSort() {
-        sort(numer.begin(), numer.end(), [](const BasicTerm termA, const BasicTerm termB){
-            return termA.symbolTable < termB.symbolTable;
-        });
-    }
+    void ExpSort(MonomialOrder order = MonomialOrder::Lex);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+// one add or sub of two random expressions, with the dense index of basic_exp.cpp and with
+// the scan it replaces, for expressions of few symbols and many of their monomials and for
+// sparse and small ones, which must not get slower, run by `make bench`
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include "basic_exp.h"
+
+// the scan of operator+ before the dense index
+static BasicExp scanAdd(const BasicExp &expA, const BasicExp &expB, bool subtract)
+{
+    BasicExp res = expA;
+    for (const BasicTerm &term : expB.numer) {
+        size_t i = 0;
+        for ( ; i < expA.numer.size(); ++i) {
+            if (expA.numer[i].monomial == term.monomial) {
+                res.numer[i].rational = subtract ? expA.numer[i].rational - term.rational : expA.numer[i].rational + term.rational;
+                break;
+            }
+        }
+        if (i == expA.numer.size()) {
+            res.numer.push_back(subtract ? -term : term);
+        }
+    }
+    return res;
+}
+
+// distinct monomials over k symbols, of at most maxDegree of them
+static BasicExp randomExp(std::mt19937 &rng, uint32_t k, uint32_t maxDegree, size_t terms)
+{
+    std::vector<Monomial> seen;
+    BasicExp exp;
+    while (exp.numer.size() < terms) {
+        Monomial mono;
+        for (uint32_t d = rng() % (maxDegree + 1); d > 0; --d) {
+            mono.insert(rng() % k);
+        }
+        if (std::find(seen.begin(), seen.end(), mono) != seen.end()) {
+            continue;
+        }
+        seen.push_back(mono);
+        exp.numer.push_back(BasicTerm(Rational(1 + int(rng() % 9), 1), mono));
+    }
+    return exp;
+}
+
+// microseconds of one call, the best of a few rounds of at least 20 ms
+template <typename F>
+static double timeUs(F f)
+{
+    double best = 1e300;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        size_t calls = 0;
+        double us = 0;
+        do {
+            f();
+            calls++;
+            us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        } while (us < 20000);
+        best = std::min(best, us / calls);
+    }
+    return best;
+}
+
+static volatile size_t sink;   // keeps the results alive
+
+static void bench(const char *name, uint32_t k, uint32_t maxDegree, size_t terms)
+{
+    std::mt19937 rng(4115);
+    BasicExp expA = randomExp(rng, k, maxDegree, terms), expB = randomExp(rng, k, maxDegree, terms);
+    double scan = timeUs([&] {sink += scanAdd(expA, expB, false).numer.size() + scanAdd(expA, expB, true).numer.size();});
+    double dense = timeUs([&] {sink += (expA + expB).numer.size() + (expA - expB).numer.size();});
+    printf("%-32s scan %9.1f us   operator+/- %9.1f us\n", name, scan / 2, dense / 2);
+}
+
+int main()
+{
+    bench("dense, 10 symbols, 600 terms", 10, 10, 600);
+    bench("dense, 12 symbols, 2000 terms", 12, 12, 2000);
+    bench("dense, 14 symbols, 6000 terms", 14, 14, 6000);
+    bench("sparse, 40 symbols, 2000 terms", 40, 6, 2000);
+    bench("small, 8 terms", 6, 3, 8);
+    return 0;
+}
\ No newline at end of file
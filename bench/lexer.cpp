@@ -0,0 +1,160 @@
+// the lexer on generated inputs: the command lookup of commands.h against the hash sets it
+// replaced, a command-heavy input, and MB/s of runs of each kind with every scan
+// implementation (char_scan.h) and with the fsm alone, run by `make bench`
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <unistd.h>
+#include "lexer.h"
+#include "commands.h"
+#include "char_scan.h"
+
+// milliseconds of one call, the best of a few rounds of at least 100 ms
+template <typename F>
+static double timeMs(F f)
+{
+    double best = 1e300;
+    for (int round = 0; round < 3; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        size_t calls = 0;
+        double ms = 0;
+        do {
+            f();
+            calls++;
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        } while (ms < 100);
+        best = std::min(best, ms / calls);
+    }
+    return best;
+}
+
+static volatile size_t sink;   // keeps the results alive
+
+static void benchLookup()
+{
+    std::vector<std::string> names, bare;   // the lexer before looked up the name without '\\'
+    std::unordered_set<std::string> keywords, symbols;     // its pools
+    for (const Command &cmd : Commands) {
+        names.emplace_back(cmd.name);
+        bare.emplace_back(cmd.name.substr(1));
+        (cmd.kind == CommandKind::Symbol ? symbols : keywords).insert(bare.back());
+    }
+    names.push_back("\\bad");
+    bare.push_back("bad");
+    const size_t lookups = 1 << 20;
+    double hashSets = timeMs([&] {
+        for (size_t i = 0; i < lookups; ++i) {
+            const std::string &name = bare[i % bare.size()];
+            sink += keywords.count(name) + symbols.count(name);
+        }
+    });
+    double perfect = timeMs([&] {
+        for (size_t i = 0; i < lookups; ++i) {
+            sink += findCommand(names[i % names.size()]) != nullptr;
+        }
+    });
+    printf("command lookup                  hash sets %6.1f ns   perfect hash %6.1f ns\n",
+           hashSets * 1e6 / lookups, perfect * 1e6 / lookups);
+}
+
+static void benchCommands()
+{
+    std::mt19937 rng(4115);
+    std::string input;
+    size_t tokens = 0;
+    while (tokens < 90000) {
+        const Command &cmd = Commands[8 + rng() % (CommandCount - 8)];
+        input += "\\frac{";
+        input += cmd.name;
+        input += " + 2}{3} \\cdot ";
+        tokens += 11;
+    }
+    input += "1";
+    Lexer lexer;
+    lexer.setQuiet(true);
+    double ms = timeMs([&] {
+        lexer.reset();
+        lexer.tokenize(input.data(), input.size());
+        sink += lexer.getStream().size();
+    });
+    printf("command-heavy, %zu tokens     %6.2f ms\n", lexer.getStream().size(), ms);
+}
+
+// 8 MB of one kind of run, separated so that every run is a token of its own
+static std::string runsInput(char kind, std::mt19937 &rng)
+{
+    std::string input;
+    while (input.size() < (8 << 20)) {
+        size_t run = 1 + rng() % 40;
+        switch (kind) {
+        case 'd':
+            for (size_t i = 0; i < run; ++i) {
+                input.push_back(char('0' + rng() % 10));
+            }
+            input += "+";
+            break;
+        case 'w':
+            input.append(run, ' ');
+            input += "a";
+            break;
+        case 'c':
+            input += Commands[8 + rng() % 24].name;
+            input += " ";
+            break;
+        default:
+            input.push_back(char('a' + rng() % 26));
+            break;
+        }
+    }
+    return input;
+}
+
+static void benchRuns()
+{
+    char path[] = "/tmp/bench_lexer.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return;
+    }
+    close(fd);
+    std::mt19937 rng(4115);
+    const char *kinds[][2] = {{"d", "digits"}, {"w", "whitespace"}, {"c", "commands"}, {"l", "letters"}};
+    for (const auto &kind : kinds) {
+        std::string input = runsInput(kind[0][0], rng);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << input;
+        double mb = input.size() / 1e6;
+        Lexer lexer;
+        lexer.setQuiet(true);
+        printf("%-32s", kind[1]);
+        // the fsm alone, one readChar() per byte as the file is lexed, the reads included
+        double fsm = timeMs([&] {
+            lexer.reset();
+            std::ifstream file(path, std::ios::binary);
+            lexer.tokenize(file);
+        });
+        printf("fsm %5.0f MB/s", mb / fsm * 1e3);
+        for (const char *impl : {"scalar", "sse2", "avx2"}) {
+            if (!setScanImpl(impl)) {
+                continue;
+            }
+            double ms = timeMs([&] {
+                lexer.reset();
+                lexer.tokenize(input.data(), input.size());
+            });
+            printf("   %s %5.0f MB/s", impl, mb / ms * 1e3);
+        }
+        printf("\n");
+    }
+    unlink(path);
+}
+
+int main()
+{
+    benchLookup();
+    benchCommands();
+    benchRuns();
+    return 0;
+}
\ No newline at end of file
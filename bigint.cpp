@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cassert>
+#include "bigint.h"
+
+BigInt::BigInt(int64_t val)
+{
+    _neg = val < 0;
+    uint64_t mag = _neg ? 0 - uint64_t(val) : uint64_t(val);
+    while (mag != 0) {
+        _mag.push_back(uint32_t(mag));
+        mag >>= 32;
+    }
+}
+
+void BigInt::trim()
+{
+    while (!_mag.empty() && _mag.back() == 0) {
+        _mag.pop_back();
+    }
+    if (_mag.empty()) {
+        _neg = false;
+    }
+}
+
+size_t BigInt::bits() const
+{
+    return _mag.empty() ? 0 : 32 * _mag.size() - __builtin_clz(_mag.back());
+}
+
+int BigInt::compareMag(const Limbs &a, const Limbs &b)
+{
+    if (a.size() != b.size()) {
+        return a.size() < b.size() ? -1 : 1;
+    }
+    for (size_t i = a.size(); i-- > 0; ) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+void BigInt::addMag(const Limbs &a, const Limbs &b, Limbs &res)
+{
+    const Limbs &lng = a.size() >= b.size() ? a : b;
+    const Limbs &shrt = a.size() >= b.size() ? b : a;
+    uint64_t carry = 0;
+    res.clear();
+    res.reserve(lng.size() + 1);
+    for (size_t i = 0; i < lng.size(); ++i) {
+        carry += uint64_t(lng[i]) + (i < shrt.size() ? shrt[i] : 0);
+        res.push_back(uint32_t(carry));
+        carry >>= 32;
+    }
+    if (carry != 0) {
+        res.push_back(uint32_t(carry));
+    }
+}
+
+void BigInt::subMag(const Limbs &a, const Limbs &b, Limbs &res)
+{
+    int64_t borrow = 0;
+    res.clear();
+    res.reserve(a.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        int64_t diff = int64_t(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = diff < 0;
+        res.push_back(uint32_t(diff + (borrow << 32)));
+    }
+}
+
+BigInt BigInt::signedSum(const BigInt &a, const BigInt &b, bool negateB)
+{
+    bool negB = negateB ? !b._neg : b._neg;
+    BigInt res;
+    if (a._neg == negB) {
+        addMag(a._mag, b._mag, res._mag);
+        res._neg = a._neg;
+    } else if (compareMag(a._mag, b._mag) >= 0) {
+        subMag(a._mag, b._mag, res._mag);
+        res._neg = a._neg;
+    } else {
+        subMag(b._mag, a._mag, res._mag);
+        res._neg = negB;
+    }
+    res.trim();
+    return res;
+}
+
+BigInt BigInt::operator-() const
+{
+    BigInt res = *this;
+    res._neg = !_neg && !_mag.empty();
+    return res;
+}
+
+BigInt operator+(const BigInt &a, const BigInt &b)
+{
+    return BigInt::signedSum(a, b, false);
+}
+
+BigInt operator-(const BigInt &a, const BigInt &b)
+{
+    return BigInt::signedSum(a, b, true);
+}
+
+BigInt operator*(const BigInt &a, const BigInt &b)
+{
+    BigInt res;
+    if (a.isZero() || b.isZero()) {
+        return res;
+    }
+    size_t len = a._mag.size() + b._mag.size();
+    res._mag.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+        res._mag.push_back(0);
+    }
+    for (size_t i = 0; i < a._mag.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b._mag.size(); ++j) {
+            carry += uint64_t(a._mag[i]) * b._mag[j] + res._mag[i + j];
+            res._mag[i + j] = uint32_t(carry);
+            carry >>= 32;
+        }
+        res._mag[i + b._mag.size()] = uint32_t(carry);
+    }
+    res._neg = a._neg != b._neg;
+    res.trim();
+    return res;
+}
+
+// Knuth's algorithm D (TAOCP 4.3.1), v is not zero and not longer than u
+void BigInt::divMag(const Limbs &u, const Limbs &v, Limbs &q, Limbs &r)
+{
+    size_t m = u.size(), n = v.size();
+    q.clear();
+    r.clear();
+    if (n == 1) {
+        std::vector<uint32_t> quot(m);
+        uint64_t rem = 0;
+        for (size_t i = m; i-- > 0; ) {
+            uint64_t cur = rem << 32 | u[i];
+            quot[i] = uint32_t(cur / v[0]);
+            rem = cur % v[0];
+        }
+        for (uint32_t limb : quot) {
+            q.push_back(limb);
+        }
+        if (rem != 0) {
+            r.push_back(uint32_t(rem));
+        }
+        return;
+    }
+
+    // normalise, so that the top bit of the divisor is set
+    int s = __builtin_clz(v[n - 1]);
+    std::vector<uint32_t> vn(n), un(m + 1), quot(m - n + 1);
+    for (size_t i = n - 1; i > 0; --i) {
+        vn[i] = uint32_t(v[i] << s | uint64_t(v[i - 1]) >> (32 - s));
+    }
+    vn[0] = v[0] << s;
+    un[m] = uint32_t(uint64_t(u[m - 1]) >> (32 - s));
+    for (size_t i = m - 1; i > 0; --i) {
+        un[i] = uint32_t(u[i] << s | uint64_t(u[i - 1]) >> (32 - s));
+    }
+    un[0] = u[0] << s;
+
+    const uint64_t base = uint64_t(1) << 32;
+    for (size_t j = m - n + 1; j-- > 0; ) {
+        uint64_t num = uint64_t(un[j + n]) << 32 | un[j + n - 1];
+        uint64_t qhat = num / vn[n - 1];
+        uint64_t rhat = num % vn[n - 1];
+        while (qhat >= base || qhat * vn[n - 2] > (rhat << 32 | un[j + n - 2])) {
+            qhat--;
+            rhat += vn[n - 1];
+            if (rhat >= base) {
+                break;
+            }
+        }
+        int64_t borrow = 0, t;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t p = qhat * vn[i];
+            t = int64_t(un[i + j]) - borrow - int64_t(p & 0xffffffff);
+            un[i + j] = uint32_t(t);
+            borrow = int64_t(p >> 32) - (t >> 32);
+        }
+        t = int64_t(un[j + n]) - borrow;
+        un[j + n] = uint32_t(t);
+        quot[j] = uint32_t(qhat);
+        if (t < 0) {
+            // qhat was one too large, add the divisor back
+            quot[j]--;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                carry += uint64_t(un[i + j]) + vn[i];
+                un[i + j] = uint32_t(carry);
+                carry >>= 32;
+            }
+            un[j + n] = uint32_t(un[j + n] + carry);
+        }
+    }
+    for (uint32_t limb : quot) {
+        q.push_back(limb);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        r.push_back(uint32_t(un[i] >> s | uint64_t(un[i + 1]) << (32 - s)));
+    }
+}
+
+BigInt operator/(const BigInt &a, const BigInt &b)
+{
+    assert("division by zero" && !b.isZero());
+    BigInt quot, rem;
+    if (BigInt::compareMag(a._mag, b._mag) < 0) {
+        return quot;
+    }
+    BigInt::divMag(a._mag, b._mag, quot._mag, rem._mag);
+    quot._neg = a._neg != b._neg;
+    quot.trim();
+    return quot;
+}
+
+bool operator==(const BigInt &a, const BigInt &b)
+{
+    return a._neg == b._neg && BigInt::compareMag(a._mag, b._mag) == 0;
+}
+
+// Euclid on the magnitudes, with machine words once both fit in 64 bits
+BigInt BigInt::gcd(const BigInt &a, const BigInt &b)
+{
+    BigInt x = a, y = b;
+    x._neg = y._neg = false;
+    while (!y.isZero()) {
+        if (x._mag.size() <= 2 && y._mag.size() <= 2) {
+            uint64_t u = x._mag.size() == 2 ? uint64_t(x._mag[1]) << 32 | x._mag[0] : x._mag.empty() ? 0 : x._mag[0];
+            uint64_t v = y._mag.size() == 2 ? uint64_t(y._mag[1]) << 32 | y._mag[0] : y._mag[0];
+            while (v != 0) {
+                uint64_t t = u % v;
+                u = v;
+                v = t;
+            }
+            BigInt res;
+            while (u != 0) {
+                res._mag.push_back(uint32_t(u));
+                u >>= 32;
+            }
+            return res;
+        }
+        BigInt quot, rem;
+        if (compareMag(x._mag, y._mag) < 0) {
+            rem = x;
+        } else {
+            divMag(x._mag, y._mag, quot._mag, rem._mag);
+            rem.trim();
+        }
+        x = std::move(y);
+        y = std::move(rem);
+    }
+    return x;
+}
+
+// nine decimal digits at a time
+std::string BigInt::toString() const
+{
+    if (isZero()) {
+        return "0";
+    }
+    std::vector<uint32_t> mag(_mag.begin(), _mag.end());
+    std::string digits;
+    while (!mag.empty()) {
+        uint64_t rem = 0;
+        for (size_t i = mag.size(); i-- > 0; ) {
+            uint64_t cur = rem << 32 | mag[i];
+            mag[i] = uint32_t(cur / 1000000000);
+            rem = cur % 1000000000;
+        }
+        while (!mag.empty() && mag.back() == 0) {
+            mag.pop_back();
+        }
+        for (int i = 0; i < 9 && (rem != 0 || !mag.empty()); ++i) {
+            digits.push_back(char('0' + rem % 10));
+            rem /= 10;
+        }
+    }
+    if (_neg) {
+        digits.push_back('-');
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
\ No newline at end of file
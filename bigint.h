@@ -0,0 +1,48 @@
+#ifndef PLT_BIGINT_H
+#define PLT_BIGINT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "small_vector.h"
+
+/* Arbitrary precision integer, sign and magnitude, for the exact coefficients of
+ * domain_exp.h. The magnitude is little-endian 32-bit limbs without leading zero limbs,
+ * zero has none. Values up to 64 bits stay inside the object.
+ */
+class BigInt {
+public:
+    BigInt() {};
+    BigInt(int64_t val);
+
+    bool isZero() const {return _mag.empty();}
+    bool negative() const {return _neg;}
+    size_t bits() const;
+    std::string toString() const;
+
+    BigInt operator-() const;
+    friend BigInt operator+(const BigInt &a, const BigInt &b);
+    friend BigInt operator-(const BigInt &a, const BigInt &b);
+    friend BigInt operator*(const BigInt &a, const BigInt &b);
+    friend BigInt operator/(const BigInt &a, const BigInt &b);     // rounded towards zero
+    friend bool operator==(const BigInt &a, const BigInt &b);
+    friend bool operator!=(const BigInt &a, const BigInt &b) {return !(a == b);}
+
+    static BigInt gcd(const BigInt &a, const BigInt &b);    // not negative, gcd(0, 0) = 0
+
+private:
+    typedef SmallVector<uint32_t, 2> Limbs;
+
+    Limbs _mag;
+    bool _neg {false};
+
+    void trim();
+    static int compareMag(const Limbs &a, const Limbs &b);
+    static void addMag(const Limbs &a, const Limbs &b, Limbs &res);
+    static void subMag(const Limbs &a, const Limbs &b, Limbs &res);    // |a| >= |b|
+    static void divMag(const Limbs &u, const Limbs &v, Limbs &q, Limbs &r);
+    static BigInt signedSum(const BigInt &a, const BigInt &b, bool negateB);
+};
+
+#endif
\ No newline at end of file
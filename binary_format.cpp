@@ -0,0 +1,250 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "binary_format.h"
+#include "error.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the records are read in place");
+
+// the header of a file of kind magic, nullptr if it is too short, misaligned or of another kind
+static const FileHeader *readHeader(const char *data, size_t len, const char *magic, uint32_t version)
+{
+    if (len < sizeof(FileHeader) || reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+        return nullptr;
+    }
+    const FileHeader *header = reinterpret_cast<const FileHeader*>(data);
+    if (memcmp(header->magic, magic, 4) != 0 || header->version != version) {
+        return nullptr;
+    }
+    return header;
+}
+
+static void putHeader(std::string &buf, const char *magic, uint32_t version, uint32_t count, uint32_t sparseIds,
+                      uint32_t symbols, uint32_t textBytes)
+{
+    FileHeader header {};
+    memcpy(header.magic, magic, 4);
+    header.version = version;
+    header.count = count;
+    header.sparseIds = sparseIds;
+    header.symbols = symbols;
+    header.textBytes = textBytes;
+    buf.append(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+// the text is one the lexer would have produced for a token of class cls
+static bool validToken(TokenClass cls, std::string_view text)
+{
+    switch (cls) {
+    case TokenClass::Symbol:
+        return !SymbolTable::canonical(std::string(text)).empty();
+    case TokenClass::Number:
+        return text.find_first_not_of("0123456789") == std::string_view::npos;
+    case TokenClass::Keyword:
+    case TokenClass::Operator:
+        if (const Command *cmd = findCommand(text)) {
+            return commandClass(cmd->kind) == cls;
+        }
+        return cls == TokenClass::Operator && text.size() == 1 && classifyChar(text[0]) == CharacterType::Operator;
+    case TokenClass::LeftParenthesis:
+    case TokenClass::RightParenthesis:
+    case TokenClass::LeftBrace:
+    case TokenClass::RightBrace:
+        return text.size() == 1 && tokenizeChar(text[0]) == cls;
+    default:
+        return false;
+    }
+}
+
+int TokenView::open(const char *data, size_t len)
+{
+    const FileHeader *header = readHeader(data, len, "PLTT", Version);
+    if (header == nullptr || (len - sizeof(FileHeader)) / sizeof(TokenRecord) < header->count ||
+        len != sizeof(FileHeader) + header->count * sizeof(TokenRecord) + size_t(header->textBytes)) {
+        return Error::InvalidBinary;
+    }
+    const TokenRecord *tokens = reinterpret_cast<const TokenRecord*>(data + sizeof(FileHeader));
+    const char *text = data + sizeof(FileHeader) + header->count * sizeof(TokenRecord);
+    for (uint32_t i = 0; i < header->count; ++i) {
+        if (tokens[i].length == 0 || tokens[i].offset > header->textBytes || header->textBytes - tokens[i].offset < tokens[i].length ||
+            !validToken(TokenClass(tokens[i].cls), std::string_view(text + tokens[i].offset, tokens[i].length))) {
+            return Error::InvalidBinary;
+        }
+    }
+    _header = header;
+    _tokens = tokens;
+    _text = text;
+    return Error::Success;
+}
+
+int ResultView::open(const char *data, size_t len)
+{
+    const FileHeader *header = readHeader(data, len, "PLTR", Version);
+    if (header == nullptr) {
+        return Error::InvalidBinary;
+    }
+    size_t terms = sizeof(FileHeader);
+    size_t sparse = terms + size_t(header->count) * sizeof(TermRecord);
+    size_t names = sparse + size_t(header->sparseIds) * sizeof(uint32_t);
+    size_t text = names + size_t(header->symbols) * sizeof(NameRecord);
+    if (text + header->textBytes != len) {
+        return Error::InvalidBinary;
+    }
+    _header = header;
+    _terms = reinterpret_cast<const TermRecord*>(data + terms);
+    _sparse = reinterpret_cast<const uint32_t*>(data + sparse);
+    _names = reinterpret_cast<const NameRecord*>(data + names);
+    _text = data + text;
+
+    for (uint32_t i = 0; i < header->count; ++i) {
+        const TermRecord &term = _terms[i];
+        if (term.denom == 0 || term.sparseOffset > header->sparseIds || header->sparseIds - term.sparseOffset < term.sparseCount) {
+            _header = nullptr;
+            return Error::InvalidBinary;
+        }
+    }
+    for (uint32_t i = 0; i < header->symbols; ++i) {
+        const NameRecord &name = _names[i];
+        if (name.id <= SymbolTable::Unknown || name.offset > header->textBytes || header->textBytes - name.offset < name.length ||
+            SymbolTable::canonical(std::string(_text + name.offset, name.length)).empty()) {
+            _header = nullptr;
+            return Error::InvalidBinary;
+        }
+    }
+    return Error::Success;
+}
+
+int ResultView::load(BasicExp &exp) const
+{
+    // stored id -> id of this process, only for the ids above the fixed ones
+    std::vector<std::pair<uint32_t, uint32_t> > ids;
+    bool same = true;
+    for (uint32_t i = 0; i < _header->symbols; ++i) {
+        uint32_t id = SymbolTable::global().intern(std::string(_text + _names[i].offset, _names[i].length));
+        ids.emplace_back(_names[i].id, id);
+        same = same && id == _names[i].id;
+    }
+    std::sort(ids.begin(), ids.end());
+
+    exp.numer.clear();
+    exp.numer.reserve(_header->count);
+    for (uint32_t i = 0; i < _header->count; ++i) {
+        const TermRecord &term = _terms[i];
+        Monomial monomial;
+        bool known = true;
+        auto add = [&](uint32_t id) {
+            if (id > SymbolTable::Unknown) {
+                auto it = std::lower_bound(ids.begin(), ids.end(), std::make_pair(id, uint32_t(0)));
+                if (it == ids.end() || it->first != id) {
+                    known = false;
+                    return;
+                }
+                id = same ? id : it->second;
+            }
+            monomial.insert(id);
+        };
+        for (uint64_t rest = term.dense; rest != 0; rest &= rest - 1) {
+            add(__builtin_ctzll(rest));
+        }
+        for (uint32_t j = 0; j < term.sparseCount; ++j) {
+            add(sparse(i)[j]);
+        }
+        if (!known) {
+            exp.numer.clear();
+            return Error::InvalidBinary;
+        }
+        exp.numer.push_back(BasicTerm(Rational(term.numer, term.denom), std::move(monomial)));
+    }
+    return Error::Success;
+}
+
+void storeTokens(const std::vector<std::pair<TokenClass, std::string> > &stream, const std::vector<uint32_t> &positions,
+                 std::string &buf)
+{
+    size_t count = stream.size();
+    if (count > 0 && stream.back().first == TokenClass::EOS) {
+        count--;
+    }
+    std::string text;
+    std::vector<TokenRecord> tokens(count);
+    for (size_t i = 0; i < count; ++i) {
+        tokens[i].cls = uint8_t(stream[i].first);
+        tokens[i].pos = positions[i];
+        tokens[i].offset = text.size();
+        tokens[i].length = stream[i].second.size();
+        text += stream[i].second;
+    }
+    putHeader(buf, "PLTT", TokenView::Version, count, 0, 0, text.size());
+    buf.append(reinterpret_cast<const char*>(tokens.data()), count * sizeof(TokenRecord));
+    buf += text;
+}
+
+void storeResult(const BasicExp &exp, std::string &buf)
+{
+    std::vector<TermRecord> terms;
+    std::vector<uint32_t> sparse;
+    Monomial used;
+    for (const BasicTerm &term : exp.numer) {
+        TermRecord rec {term.rational.numer, term.rational.denom, 0, uint32_t(sparse.size()), 0};
+        term.monomial.forEach([&rec, &sparse](uint32_t id) {
+            if (id < 64) {
+                rec.dense |= uint64_t(1) << id;
+            } else {
+                sparse.push_back(id);
+                rec.sparseCount++;
+            }
+        });
+        terms.push_back(rec);
+        used = used | term.monomial;
+    }
+
+    std::vector<NameRecord> names;
+    std::string text;
+    used.forEach([&names, &text](uint32_t id) {
+        if (id > SymbolTable::Unknown) {
+            const std::string &name = SymbolTable::global().name(id);
+            names.push_back(NameRecord{id, uint32_t(text.size()), uint32_t(name.size())});
+            text += name;
+        }
+    });
+
+    putHeader(buf, "PLTR", ResultView::Version, terms.size(), sparse.size(), names.size(), text.size());
+    buf.append(reinterpret_cast<const char*>(terms.data()), terms.size() * sizeof(TermRecord));
+    buf.append(reinterpret_cast<const char*>(sparse.data()), sparse.size() * sizeof(uint32_t));
+    buf.append(reinterpret_cast<const char*>(names.data()), names.size() * sizeof(NameRecord));
+    buf += text;
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data != nullptr) {
+        munmap(_data, _size);
+    }
+}
+
+int MappedFile::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Error::CannotOpenFile;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return Error::CannotOpenFile;
+    }
+    _size = st.st_size;
+    if (_size > 0) {
+        void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            _size = 0;
+            return Error::CannotOpenFile;
+        }
+        _data = static_cast<char*>(data);
+    }
+    close(fd);
+    return Error::Success;
+}
\ No newline at end of file
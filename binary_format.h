@@ -0,0 +1,119 @@
+#ifndef PLT_BINARY_FORMAT_H
+#define PLT_BINARY_FORMAT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "lexer.h"
+#include "basic_exp.h"
+
+/* Binary files for handing the intermediate results of one stage to the next without
+ * printing and re-lexing them: the token stream of the lexer ("PLTT") and the simplified
+ * BasicExp ("PLTR"). The parsed AST is handed over as its compiled Program ("PLTP", see
+ * bytecode.h), which is the AST in postfix order.
+ *
+ * Both files are a 32 byte header followed by arrays of fixed size records in the byte
+ * order of the (little-endian) host, so a mapped file is read in place: the views below
+ * only check the bounds and hand out the records, nothing is decoded or copied.
+ *   PLTT: header, count x TokenRecord, the texts of the tokens
+ *   PLTR: header, count x TermRecord, sparse ids, symbols x NameRecord, the names
+ * A term is its coefficient and monomial, the monomial is the dense word of Monomial plus
+ * a range of the sparse ids. Ids are the ones of the writing process, the names of all
+ * ids above SymbolTable::Unknown are in the file and are interned again when loading, the
+ * terms are only remapped if a name got a different id.
+ */
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;         // tokens or terms
+    uint32_t sparseIds;     // results only
+    uint32_t symbols;       // results only, entries of the name table
+    uint32_t textBytes;     // texts of the tokens or the names
+    uint64_t reserved;
+};
+
+struct TokenRecord {
+    uint8_t cls;            // TokenClass
+    uint8_t pad[3];
+    uint32_t pos;           // character offset in the input
+    uint32_t offset;        // of the text
+    uint32_t length;
+};
+
+struct TermRecord {
+    int32_t numer;
+    int32_t denom;
+    uint64_t dense;         // the ids < 64, as in Monomial::word(0)
+    uint32_t sparseOffset;  // index of the first sparse id
+    uint32_t sparseCount;
+};
+
+struct NameRecord {
+    uint32_t id;
+    uint32_t offset;        // of the name
+    uint32_t length;
+};
+
+static_assert(sizeof(FileHeader) == 32 && sizeof(TokenRecord) == 16 && sizeof(TermRecord) == 24, "record layout");
+
+// a token stream without EOS, data has to stay valid and 8-byte aligned while it is used
+class TokenView {
+public:
+    static constexpr uint32_t Version = 1;
+
+    int open(const char *data, size_t len);     // Error::InvalidBinary if it is no valid stream
+    uint32_t size() const {return _header->count;}
+    TokenClass tokenClass(uint32_t i) const {return TokenClass(_tokens[i].cls);}
+    uint32_t position(uint32_t i) const {return _tokens[i].pos;}
+    std::string_view text(uint32_t i) const {return std::string_view(_text + _tokens[i].offset, _tokens[i].length);}
+
+private:
+    const FileHeader *_header {nullptr};
+    const TokenRecord *_tokens {nullptr};
+    const char *_text {nullptr};
+};
+
+// a simplified expression, data has to stay valid and 8-byte aligned while it is used
+class ResultView {
+public:
+    static constexpr uint32_t Version = 1;
+
+    int open(const char *data, size_t len);     // Error::InvalidBinary if it is no valid result
+    uint32_t size() const {return _header->count;}
+    const TermRecord &term(uint32_t i) const {return _terms[i];}
+    const uint32_t *sparse(uint32_t i) const {return _sparse + _terms[i].sparseOffset;}
+    int load(BasicExp &exp) const;              // the terms in the ids of this process
+
+private:
+    const FileHeader *_header {nullptr};
+    const TermRecord *_terms {nullptr};
+    const uint32_t *_sparse {nullptr};
+    const NameRecord *_names {nullptr};
+    const char *_text {nullptr};
+};
+
+// the stream (a trailing EOS is left out) or the expression, appended to buf
+void storeTokens(const std::vector<std::pair<TokenClass, std::string> > &stream, const std::vector<uint32_t> &positions,
+                 std::string &buf);
+void storeResult(const BasicExp &exp, std::string &buf);
+
+// a whole file mapped read-only
+class MappedFile {
+public:
+    MappedFile() {};
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    int open(const std::string &path);          // Error::CannotOpenFile if it cannot be mapped
+    const char *data() const {return _data;}
+    size_t size() const {return _size;}
+
+private:
+    char *_data {nullptr};
+    size_t _size {0};
+};
+
+#endif
\ No newline at end of file
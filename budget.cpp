@@ -0,0 +1,23 @@
+#include <algorithm>
+#include "budget.h"
+
+thread_local ActiveBudget activeBudget;
+
+BudgetScope::BudgetScope(const Budget &budget) : _saved(activeBudget)
+{
+    ActiveBudget active;
+    if (budget.maxTerms > 0) {
+        active.maxTerms = budget.maxTerms;
+    }
+    if (budget.maxCoefficientBits > 0) {
+        if (budget.maxCoefficientBits < 63) {
+            active.maxCoefficient = (int64_t(1) << budget.maxCoefficientBits) - 1;
+        }
+        active.maxIntCoefficient = std::min<int64_t>(active.maxCoefficient, INT32_MAX);
+    }
+    if (budget.deadlineMs > 0) {
+        active.hasDeadline = true;
+        active.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budget.deadlineMs);
+    }
+    activeBudget = active;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef PLT_BUDGET_H
+#define PLT_BUDGET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <exception>
+#include "error.h"
+
+/* Limits of one evaluation, so that a single pathological input (a product of two huge
+ * sums, say) fails with an error code instead of eating the memory or the time of a whole
+ * batch. 0 means no limit, which is the default.
+ *
+ * A BudgetScope makes a budget the one of the calling thread for its lifetime, the
+ * BasicExp and Rational operators check it with the inline functions below (a compare
+ * each, the clock is only read after ClockInterval units of work, i.e. terms produced or
+ * compared) and throw BudgetExceeded, which the Session turns into the error code. The
+ * AST size is checked once after parsing.
+ */
+struct Budget {
+    size_t maxTerms {0};                // terms of every intermediate BasicExp
+    uint32_t maxCoefficientBits {0};    // bits of every numerator and denominator computed
+    size_t maxNodes {0};                // nodes of the AST
+    uint32_t deadlineMs {0};            // wall clock time of one evaluation
+};
+
+class BudgetExceeded : public std::exception {
+public:
+    explicit BudgetExceeded(Error err) : error(err) {};
+    const char *what() const noexcept override {return "budget exceeded";}
+
+    Error error;
+};
+
+// the limits of the running evaluation, everything is allowed outside of a BudgetScope
+struct ActiveBudget {
+    static constexpr size_t ClockInterval = 4096;
+
+    size_t maxTerms {SIZE_MAX};
+    int64_t maxCoefficient {INT64_MAX};
+    int64_t maxIntCoefficient {INT64_MAX};  // the same, at most INT32_MAX if there is a limit
+    bool hasDeadline {false};
+    size_t work {0};                    // since the clock was read
+    std::chrono::steady_clock::time_point deadline;
+};
+
+extern thread_local ActiveBudget activeBudget;
+
+class BudgetScope {
+public:
+    explicit BudgetScope(const Budget &budget);
+    ~BudgetScope() {activeBudget = _saved;}
+    BudgetScope(const BudgetScope &) = delete;
+    BudgetScope &operator=(const BudgetScope &) = delete;
+
+private:
+    ActiveBudget _saved;
+};
+
+inline void checkTerms(size_t terms)
+{
+    if (terms > activeBudget.maxTerms) {
+        throw BudgetExceeded(Error::TooManyTerms);
+    }
+}
+
+// for the int coefficients of a BasicExp, any limit stops them before they overflow
+inline int checkCoefficient(int64_t val)
+{
+    if (val > activeBudget.maxIntCoefficient || val < -activeBudget.maxIntCoefficient) {
+        throw BudgetExceeded(Error::CoefficientTooLarge);
+    }
+    return int(val);
+}
+
+// for coefficients which are not int64_t, see domain_exp.h
+inline void checkCoefficientBits(size_t bits)
+{
+    int64_t max = activeBudget.maxCoefficient;
+    if (max != INT64_MAX && bits > size_t(64 - __builtin_clzll(max))) {
+        throw BudgetExceeded(Error::CoefficientTooLarge);
+    }
+}
+
+inline void checkDeadline(size_t work)
+{
+    ActiveBudget &budget = activeBudget;
+    if (budget.hasDeadline && (budget.work += work) >= ActiveBudget::ClockInterval) {
+        budget.work = 0;
+        if (std::chrono::steady_clock::now() > budget.deadline) {
+            throw BudgetExceeded(Error::DeadlineExceeded);
+        }
+    }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include "buffer_pool.h"
+
+// gives the buffers of its thread back when the thread exits, the buffers of thread_locals
+// destroyed after it go straight to the heap
+struct BufferPool::ThreadExit {
+    ~ThreadExit() {
+        trim();
+        _state.closed = true;
+    }
+};
+
+void BufferPool::trim()
+{
+    State &state = _state;
+    for (uint32_t k = 0; k < Buckets; ++k) {
+        while (state.free[k] != nullptr) {
+            void *buf = state.free[k];
+            state.free[k] = *static_cast<void**>(buf);
+            ::operator delete(buf);
+        }
+    }
+    state.stats.cachedBytes = 0;
+}
+
+// the destructor of a thread_local only runs if it was constructed in that thread
+void BufferPool::registerThread()
+{
+    static thread_local ThreadExit exit;
+    (void)exit;
+    _state.registered = true;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef PLT_BUFFER_POOL_H
+#define PLT_BUFFER_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include "small_vector.h"
+
+/* Per thread free lists of heap buffers, the allocator of the terms of BasicExp (see
+ * SmallVector). Nearly every BasicExp operator builds its result in a new vector while
+ * the operands and the temporaries of the evaluation are freed moments later, so the
+ * buffers are not given back to the heap but kept for the next one of the same size.
+ *
+ * Buffers come in powers of two bytes, bucket k holds the free ones of 2^k bytes as a
+ * list linked through their first word. A SmallVector frees its buffer with the bytes of
+ * its capacity, i.e. 2^k rounded down to whole elements, which still round up to 2^k
+ * since it asks for two elements at least. A buffer freed by another thread than the
+ * one which allocated it goes to the pool of the freeing thread. Each thread keeps at
+ * most MaxCachedBytes, the rest goes back to the heap, as do all of its buffers when it
+ * exits.
+ *
+ * Once the buffers of a batch of expressions are in the pool the evaluation runs without
+ * touching the heap, BufferPool::stats() tells how often a buffer was taken from the pool
+ * (hits) and how often it had to be allocated (misses, also counted in heapAllocations).
+ */
+class BufferPool {
+public:
+    static constexpr uint32_t MinBucket = 6;        // 64 bytes, room for the link and a few terms
+    static constexpr uint32_t Buckets = 48;
+    static constexpr size_t MaxCachedBytes = size_t(64) << 20;
+
+    struct Stats {
+        size_t hits {0};
+        size_t misses {0};
+        size_t cachedBytes {0};     // in the free lists
+    };
+
+    // at least bytes, bytes is set to the size of the buffer
+    static void *allocate(size_t &bytes) {
+        uint32_t k = bucketAbove(bytes);
+        bytes = size_t(1) << k;
+        State &state = _state;
+        if (k < Buckets && state.free[k] != nullptr) {
+            void *buf = state.free[k];
+            state.free[k] = *static_cast<void**>(buf);
+            state.stats.hits++;
+            state.stats.cachedBytes -= bytes;
+            return buf;
+        }
+        state.stats.misses++;
+        heapAllocations++;
+        return ::operator new(bytes);
+    }
+
+    static void deallocate(void *buf, size_t bytes) {
+        uint32_t k = bucketAbove(bytes);
+        State &state = _state;
+        if (k >= Buckets || state.closed || state.stats.cachedBytes + (size_t(1) << k) > MaxCachedBytes) {
+            ::operator delete(buf);
+            return;
+        }
+        if (!state.registered) {
+            registerThread();
+        }
+        *static_cast<void**>(buf) = state.free[k];
+        state.free[k] = buf;
+        state.stats.cachedBytes += size_t(1) << k;
+    }
+
+    static const Stats &stats() {return _state.stats;}     // of the calling thread
+    static void trim();     // gives the free buffers of the calling thread back to the heap
+
+private:
+    // trivially destructible, so it can be used while the thread exits
+    struct State {
+        void *free[Buckets] {};
+        Stats stats;
+        bool registered {false};    // trim() runs when the thread exits
+        bool closed {false};        // the thread is exiting, nothing is kept any more
+    };
+
+    struct ThreadExit;
+
+    static thread_local State _state;
+
+    static uint32_t bucketAbove(size_t bytes) {
+        return bytes <= (size_t(1) << MinBucket) ? MinBucket : 64 - __builtin_clzll(bytes - 1);
+    }
+
+    static void registerThread();
+};
+
+// constant initialised, so the hot path needs no initialisation check
+inline thread_local BufferPool::State BufferPool::_state;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include <cstring>
+#include <algorithm>
+#include "bytecode.h"
+#include "error.h"
+#include "substitution.h"
+
+static const char *opNames[] = {"PUSH_NUM", "PUSH_SYM", "ADD", "SUB", "MUL", "DIV", "NEG"};
+
+// every instruction finds its operands on the stack and exactly one value is left
+bool Program::verify() const
+{
+    size_t depth = 0;
+    for (const Instruction &ins : code) {
+        switch (ins.op) {
+        case OpCode::PushNum:
+            depth++;
+            break;
+        case OpCode::PushSym:
+            if (ins.operand < 0 || uint32_t(ins.operand) >= SymbolTable::global().size()) {
+                return false;
+            }
+            depth++;
+            break;
+        case OpCode::Add:
+        case OpCode::Sub:
+        case OpCode::Mul:
+        case OpCode::Div:
+            if (depth < 2) {
+                return false;
+            }
+            depth--;
+            break;
+        case OpCode::Neg:
+            if (depth < 1) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+    return depth == 1;
+}
+
+void Program::dump(std::ostream &os) const
+{
+    for (size_t i = 0; i < code.size(); ++i) {
+        os << "% " << i << ": " << opNames[uint32_t(code[i].op)];
+        if (code[i].op == OpCode::PushNum || code[i].op == OpCode::PushSym) {
+            os << " " << code[i].operand;
+        }
+        os << std::endl;
+    }
+}
+
+static void putU32(std::string &buf, uint32_t val)
+{
+    for (int i = 0; i < 4; ++i) {
+        buf.push_back(char(val >> (8 * i)));
+    }
+}
+
+static uint32_t getU32(const char *p)
+{
+    const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t(u[0]) | uint32_t(u[1]) << 8 | uint32_t(u[2]) << 16 | uint32_t(u[3]) << 24;
+}
+
+std::string Program::serialize() const
+{
+    std::vector<int32_t> symbols;
+    std::string buf("PLTP");
+    putU32(buf, Version);
+    putU32(buf, code.size());
+    for (const Instruction &ins : code) {
+        int32_t operand = ins.operand;
+        if (ins.op == OpCode::PushSym) {
+            auto it = std::find(symbols.begin(), symbols.end(), ins.operand);
+            operand = it - symbols.begin();
+            if (it == symbols.end()) {
+                symbols.push_back(ins.operand);
+            }
+        }
+        buf.push_back(char(ins.op));
+        putU32(buf, uint32_t(operand));
+    }
+    putU32(buf, symbols.size());
+    for (int32_t id : symbols) {
+        const std::string &name = SymbolTable::global().name(id);
+        putU32(buf, name.size());
+        buf.append(name);
+    }
+    return buf;
+}
+
+// the program is verified, nothing is changed if the data is not a valid program
+int Program::deserialize(const std::string &data)
+{
+    if (data.size() < 12 || memcmp(data.data(), "PLTP", 4) != 0) {
+        return Error::InvalidProgram;
+    }
+    uint32_t version = getU32(&data[4]);
+    uint32_t count = getU32(&data[8]);
+    if ((version != 1 && version != Version) || count > (data.size() - 12) / 5) {
+        return Error::InvalidProgram;
+    }
+    Program prog;
+    prog.code.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const char *p = &data[12 + 5 * i];
+        prog.emit(OpCode(uint8_t(p[0])), int32_t(getU32(p + 1)));
+    }
+
+    size_t pos = 12 + 5 * size_t(count);
+    std::vector<uint32_t> symbols;
+    if (version == 1) {
+        for (uint32_t id = 0; id <= SymbolTable::Unknown; ++id) {
+            symbols.push_back(id);
+        }
+    } else {
+        if (data.size() - pos < 4) {
+            return Error::InvalidProgram;
+        }
+        uint32_t names = getU32(&data[pos]);
+        pos += 4;
+        for (uint32_t i = 0; i < names; ++i) {
+            if (data.size() - pos < 4 || data.size() - pos - 4 < getU32(&data[pos])) {
+                return Error::InvalidProgram;
+            }
+            std::string name = data.substr(pos + 4, getU32(&data[pos]));
+            pos += 4 + name.size();
+            if (!name.empty() && SymbolTable::canonical(name).empty()) {
+                return Error::InvalidProgram;
+            }
+            symbols.push_back(SymbolTable::global().intern(name));
+        }
+    }
+    if (pos != data.size()) {
+        return Error::InvalidProgram;
+    }
+    for (Instruction &ins : prog.code) {
+        if (ins.op == OpCode::PushSym) {
+            if (ins.operand < 0 || uint32_t(ins.operand) >= symbols.size()) {
+                return Error::InvalidProgram;
+            }
+            ins.operand = symbols[ins.operand];
+        }
+    }
+    if (!prog.verify()) {
+        return Error::InvalidProgram;
+    }
+    code.swap(prog.code);
+    return Error::Success;
+}
+
+// drops the terms of the entry which are no subset of within, a term of an expression built
+// from it is the union of one of its terms and others, so it would not be one either. The
+// symbols of all of them are kept, for the checks which the full value would fail
+void Interpreter::prune(size_t entry, const Monomial &within)
+{
+    BasicExp::Terms &terms = _stack[entry].numer;
+    Monomial &symbols = _symbols[entry];
+    symbols = Monomial();
+    size_t kept = 0;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        symbols = symbols | terms[i].monomial;
+        if (terms[i].monomial.subsetOf(within)) {
+            if (kept != i) {
+                terms[kept] = std::move(terms[i]);
+            }
+            kept++;
+        }
+    }
+    while (terms.size() > kept) {
+        terms.pop_back();
+    }
+}
+
+int Interpreter::run(const Program &prog, BasicExp &result, const Monomial *within)
+{
+    try {
+        execute(prog, within);
+    } catch (const UnsupportedOperation &) {
+        return Error::Unsupported;
+    }
+    result.numer.swap(_stack[0].numer);
+    return Error::Success;
+}
+
+// the value of prog ends up in _stack[0]
+void Interpreter::execute(const Program &prog, const Monomial *within)
+{
+    size_t top = 0;     // _stack[0, top) is in use, the entries above keep their buffers
+
+    for (const Instruction &ins : prog.code) {
+        if (within != nullptr && (ins.op == OpCode::Add || ins.op == OpCode::Sub || ins.op == OpCode::Mul)) {
+            // two terms with a common symbol, as the full values would have, a*a is refused
+            if (ins.op == OpCode::Mul && !_symbols[top - 2].disjoint(_symbols[top - 1])) {
+                throw UnsupportedOperation();
+            }
+            _symbols[top - 2] = _symbols[top - 2] | _symbols[top - 1];
+        }
+        switch (ins.op) {
+        case OpCode::PushNum:
+        case OpCode::PushSym:
+            if (top == _stack.size()) {
+                _stack.emplace_back();
+            }
+            _stack[top].numer.clear();
+            if (ins.op == OpCode::PushNum) {
+                _stack[top].numer.push_back(BasicTerm(Rational(ins.operand, 1), Monomial()));
+            } else if (const BasicExp *value = boundValue(ins.operand)) {
+                _stack[top] = *value;
+            } else {
+                _stack[top].numer.push_back(BasicTerm(Rational(1, 1), Monomial::symbol(ins.operand)));
+            }
+            if (within != nullptr) {
+                _symbols.resize(_stack.size());
+                prune(top, *within);
+            }
+            top++;
+            break;
+        case OpCode::Add:
+            top--;
+            _stack[top - 1] = _stack[top - 1] + _stack[top];
+            break;
+        case OpCode::Sub:
+            top--;
+            _stack[top - 1] = _stack[top - 1] - _stack[top];
+            break;
+        case OpCode::Mul:
+            top--;
+            _stack[top - 1] = _stack[top - 1] * _stack[top];
+            break;
+        case OpCode::Div:
+            top--;
+            // a divisor with symbols, also in dropped terms, as without pruning it is refused
+            if (within != nullptr && !_symbols[top].empty()) {
+                throw UnsupportedOperation();
+            }
+            _stack[top - 1] = _stack[top - 1] / _stack[top];
+            break;
+        case OpCode::Neg:
+            _stack[top - 1] = -_stack[top - 1];
+            break;
+        }
+    }
+}
+
+const Program *ProgramCache::find(const std::string &text)
+{
+    auto it = _map.find(text);
+    if (it == _map.end()) {
+        _misses++;
+        return nullptr;
+    }
+    _hits++;
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return &it->second->second;
+}
+
+void ProgramCache::insert(const std::string &text, Program &&prog)
+{
+    auto it = _map.find(text);
+    if (it != _map.end()) {
+        it->second->second = std::move(prog);
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return;
+    }
+    if (_capacity == 0) {
+        return;
+    }
+    if (_map.size() == _capacity) {
+        _map.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+    _lru.emplace_front(text, std::move(prog));
+    _map.emplace(text, _lru.begin());
+}
@@ -0,0 +1,98 @@
+#ifndef PLT_BYTECODE_H
+#define PLT_BYTECODE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include "basic_exp.h"
+
+/* Stack bytecode for the calc() of an AST.
+ *
+ * BaseAST::compile() emits the instructions in the order calc() visits the nodes, so
+ * running the program does exactly what calc() does, only without the tree walk and the
+ * virtual calls:
+ *   PUSH_NUM n    push the number n
+ *   PUSH_SYM i    push the symbol with id i of SymbolTable::global(), or its value if it is
+ *                 bound (see substitution.h)
+ *   ADD SUB MUL DIV
+ *                 pop b, pop a, push a op b
+ *   NEG           negate the top
+ * A program is independent of the text it was compiled from, it can be serialised and
+ * run again without lexing and parsing. Symbol ids are only valid in one process, a
+ * serialised program carries the names of its symbols instead.
+ */
+
+enum class OpCode : uint8_t {
+    PushNum,
+    PushSym,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Neg,
+};
+
+struct Instruction {
+    OpCode op;
+    int32_t operand;    // the number of PushNum, the symbol id of PushSym, 0 otherwise
+};
+
+class Program {
+public:
+    static constexpr uint32_t Version = 2;
+
+    std::vector<Instruction> code;
+
+    void emit(OpCode op, int32_t operand = 0) {code.push_back(Instruction{op, operand});}
+    bool verify() const;
+    void dump(std::ostream &os = std::cout) const;
+
+    // "PLTP", version, number of instructions, then 1 byte opcode and 4 bytes operand each,
+    // then the number of symbols and length and bytes of each name, all little-endian.
+    // The operand of PUSH_SYM is the index of the name. Version 1 had no names, its
+    // operands are the fixed ids of a-z and the greek letters.
+    std::string serialize() const;
+    int deserialize(const std::string &data);
+};
+
+// runs verified programs, the stack and the buffers of its entries are reused between runs.
+// With within only the terms whose monomial is a subset of it are kept (see query.h), the
+// others are dropped where they are pushed, so nothing is expanded for them.
+// run() returns Error::Unsupported for a*a or a divisor with symbols, e.g. of a loaded program,
+// a verified program can still have them unless the symbols are bound to numbers.
+class Interpreter {
+public:
+    int run(const Program &prog, BasicExp &result, const Monomial *within = nullptr);
+
+private:
+    std::vector<BasicExp> _stack;
+    std::vector<Monomial> _symbols;    // with within, of all terms of the entries, dropped ones too
+
+    void prune(size_t entry, const Monomial &within);
+    void execute(const Program &prog, const Monomial *within);
+};
+
+// the programs of the most recently used texts
+class ProgramCache {
+public:
+    explicit ProgramCache(size_t capacity) : _capacity(capacity) {};
+
+    const Program *find(const std::string &text);
+    void insert(const std::string &text, Program &&prog);
+    size_t size() const {return _map.size();}
+    size_t hits() const {return _hits;}
+    size_t misses() const {return _misses;}
+
+private:
+    typedef std::pair<std::string, Program> Entry;
+
+    size_t _capacity;
+    std::list<Entry> _lru;     // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> _map;
+    size_t _hits {0};
+    size_t _misses {0};
+};
+
+#endif
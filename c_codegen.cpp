@@ -0,0 +1,214 @@
+#include <charconv>
+#include <numeric>
+#include "c_codegen.h"
+#include "error.h"
+
+std::string cName(uint32_t id)
+{
+    std::string name = SymbolTable::global().name(id);
+    if (!name.empty() && name[0] == '\\') {
+        name.erase(0, 1);
+    }
+    size_t brace = name.find('{');
+    if (brace != std::string::npos) {
+        name = name.substr(0, brace) + name.substr(brace + 1, name.size() - brace - 2);
+    }
+    return name;
+}
+
+static bool isIdentifier(const std::string &name)
+{
+    if (name.empty() || !(isalpha(name[0]) || name[0] == '_')) {
+        return false;
+    }
+    for (char c : name) {
+        if (!(isalnum(c) || c == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string literal(double val)
+{
+    char num[32];
+    std::string res(num, std::to_chars(num, num + sizeof(num), val).ptr);
+    if (res.find_first_of(".e") == std::string::npos) {
+        res += ".0";
+    }
+    return res;
+}
+
+int32_t HornerForm::constant(const Rational &rat)
+{
+    int64_t numer = rat.numer, denom = rat.denom;
+    int64_t g = std::gcd(numer, denom);
+    numer /= g;
+    denom /= g;
+    if (denom < 0) {
+        numer = -numer;
+        denom = -denom;
+    }
+    auto ins = _ids.emplace(std::make_tuple(-1, numer, denom), int32_t(_nodes.size()));
+    if (ins.second) {
+        _nodes.push_back(Node{-1, double(numer) / double(denom), -1, -1, 0, -1});
+    }
+    return ins.first->second;
+}
+
+// equal nodes are shared, their children only count the first parent
+int32_t HornerForm::node(int32_t symbol, int32_t factor, int32_t rest)
+{
+    auto ins = _ids.emplace(std::make_tuple(symbol, factor, rest), int32_t(_nodes.size()));
+    if (ins.second) {
+        _nodes.push_back(Node{symbol, 0, factor, rest, 0, -1});
+        _nodes[factor].uses++;
+        if (rest >= 0) {
+            _nodes[rest].uses++;
+        }
+    }
+    return ins.first->second;
+}
+
+// the monomials are distinct, so there is one constant term at most
+int32_t HornerForm::build(std::vector<Term> &terms)
+{
+    std::map<uint32_t, size_t> counts;
+    for (const Term &term : terms) {
+        term.second.forEach([&counts](uint32_t id) {counts[id]++;});
+    }
+    if (counts.empty()) {
+        return constant(terms.empty() ? Rational(0, 1) : terms[0].first);
+    }
+
+    uint32_t x = counts.begin()->first;
+    for (const auto &count : counts) {
+        if (count.second > counts[x]) {
+            x = count.first;
+        }
+    }
+    std::vector<Term> factor, rest;
+    for (Term &term : terms) {
+        if (term.second.contains(x)) {
+            term.second.erase(x);
+            factor.push_back(std::move(term));
+        } else {
+            rest.push_back(std::move(term));
+        }
+    }
+    terms.clear();
+    int32_t f = build(factor);
+    int32_t r = rest.empty() ? -1 : build(rest);
+    return node(x, f, r);
+}
+
+bool HornerForm::build(const BasicExp &exp)
+{
+    std::vector<Term> terms;
+    _nodes.clear();
+    _ids.clear();
+    _symbols = Monomial();
+    for (const BasicTerm &term : exp.numer) {
+        if (term.rational.numer == 0) {
+            continue;
+        }
+        if (term.monomial.contains(SymbolTable::Unknown)) {
+            return false;
+        }
+        terms.emplace_back(term.rational, term.monomial);
+        _symbols = _symbols | term.monomial;
+    }
+    _root = build(terms);
+    return true;
+}
+
+size_t HornerForm::multiplications() const
+{
+    size_t count = 0;
+    for (const Node &node : _nodes) {
+        if (node.symbol >= 0) {
+            const Node &factor = _nodes[node.factor];
+            count += !(factor.symbol < 0 && (factor.constant == 1 || factor.constant == -1));
+        }
+    }
+    return count;
+}
+
+// the text of a node, a node used more than once is put into a local the first time
+std::string HornerForm::text(int32_t id)
+{
+    Node &node = _nodes[id];
+    if (node.temp >= 0) {
+        return "t" + std::to_string(node.temp);
+    }
+    if (node.symbol < 0) {
+        return literal(node.constant);
+    }
+
+    std::string x = cName(node.symbol);
+    const Node &factor = _nodes[node.factor];
+    std::string res;
+    if (factor.symbol < 0) {
+        if (factor.constant == 1) {
+            res = x;
+        } else if (factor.constant == -1) {
+            res = "-" + x;
+        } else {
+            res = literal(factor.constant) + " * " + x;
+        }
+    } else {
+        std::string f = text(node.factor);
+        if (isSum(node.factor)) {
+            res = x + " * (" + f + ")";
+        } else {
+            res = f + " * " + x;    // the sign and the coefficient stay in front
+        }
+    }
+    if (node.rest >= 0) {
+        std::string r = text(node.rest);
+        res += r[0] == '-' ? " - " + r.substr(1) : " + " + r;
+    }
+
+    // a bare symbol is no cheaper in a local
+    if (node.uses > 1 && !(node.rest < 0 && factor.symbol < 0 && factor.constant == 1)) {
+        _nodes[id].temp = _locals.size();
+        _locals.push_back(res);
+        return "t" + std::to_string(_nodes[id].temp);
+    }
+    return res;
+}
+
+void HornerForm::emit(const std::string &name, std::ostream &os)
+{
+    _locals.clear();
+    for (Node &node : _nodes) {
+        node.temp = -1;
+    }
+    std::string body = text(_root);
+
+    os << "// multivariate horner form, " << multiplications() << " multiplications\n";
+    os << "double " << name << "(";
+    bool first = true;
+    _symbols.forEach([&os, &first](uint32_t id) {
+        os << (first ? "" : ", ") << "double " << cName(id);
+        first = false;
+    });
+    os << (first ? "void" : "") << ")\n{\n";
+    for (size_t i = 0; i < _locals.size(); ++i) {
+        os << "    const double t" << i << " = " << _locals[i] << ";\n";
+    }
+    os << "    return " << body << ";\n}\n";
+}
+
+int emitC(const BasicExp &exp, const std::string &name, std::ostream &os)
+{
+    if (!isIdentifier(name)) {
+        return Error::BadIdentifier;
+    }
+    HornerForm form;
+    if (!form.build(exp)) {
+        return Error::BadSymbol;
+    }
+    form.emit(name, os);
+    return Error::Success;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef PLT_C_CODEGEN_H
+#define PLT_C_CODEGEN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <iostream>
+#include "basic_exp.h"
+
+/* C code evaluating a simplified expression, the numerical twin of BasicExp::CodeGen().
+ *
+ * The terms are factored into multivariate Horner form: the symbol in the most terms is
+ * taken out, P = x * Q + R, and Q and R are factored the same way. Equal subexpressions
+ * of different branches are built once (the nodes are hash-consed) and every one used
+ * more than once is hoisted into a local. The coefficients are computed at generation
+ * time and emitted as double literals, e.g. for \frac{1}{2}ab+\frac{1}{3}ac+2b:
+ *   // multivariate horner form, 4 multiplications
+ *   double f(double a, double b, double c)
+ *   {
+ *       return a * (0.5 * b + 0.3333333333333333 * c) + 2.0 * b;
+ *   }
+ * The parameters are the symbols of the expression in id order, \alpha and x_{1} are
+ * named alpha and x_1. The code is C99 and C++.
+ */
+class HornerForm {
+public:
+    // the form of exp, false if exp has a symbol without a name (left over by a lexer error)
+    bool build(const BasicExp &exp);
+    void emit(const std::string &name, std::ostream &os);
+
+    size_t multiplications() const;
+
+private:
+    struct Node {
+        int32_t symbol;     // -1 for a constant
+        double constant;
+        int32_t factor;     // symbol * factor + rest, rest is -1 if there is none
+        int32_t rest;
+        uint32_t uses;      // number of parents
+        int32_t temp;       // index of the local holding it, -1 if it is inlined
+    };
+    typedef std::pair<Rational, Monomial> Term;
+
+    std::vector<Node> _nodes;
+    std::map<std::tuple<int32_t, int64_t, int64_t>, int32_t> _ids;
+    int32_t _root {-1};
+    Monomial _symbols;
+    std::vector<std::string> _locals;
+
+    int32_t build(std::vector<Term> &terms);
+    int32_t constant(const Rational &rat);
+    int32_t node(int32_t symbol, int32_t factor, int32_t rest);
+    std::string text(int32_t id);
+    bool isSum(int32_t id) const {return _nodes[id].rest >= 0 && _nodes[id].temp < 0;}
+};
+
+// the C identifier of a symbol, "" for ids without a name
+std::string cName(uint32_t id);
+
+// writes the function name() evaluating exp, Error::BadIdentifier if name is no C identifier
+int emitC(const BasicExp &exp, const std::string &name, std::ostream &os);
+
+#endif
\ No newline at end of file
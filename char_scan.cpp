@@ -0,0 +1,176 @@
+#include <cstdint>
+#include <string_view>
+#include "char_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PLT_SCAN_X86
+#endif
+
+enum class RunKind {
+    Digits,
+    Letters,
+    Spaces,
+};
+
+template <RunKind kind>
+static inline bool matches(char c)
+{
+    switch (kind) {
+    case RunKind::Digits:
+        return c >= '0' && c <= '9';
+    case RunKind::Letters:
+        return c >= 'a' && c <= 'z';
+    default:
+        return c == ' ' || c == '\0' || c == '\t' || c == '\n';
+    }
+}
+
+template <RunKind kind>
+static size_t scalarRun(const char *p, size_t len)
+{
+    size_t i = 0;
+    while (i < len && matches<kind>(p[i])) {
+        ++i;
+    }
+    return i;
+}
+
+#ifdef PLT_SCAN_X86
+// the bytes are signed, so everything from 0x80 up is below both ranges
+template <RunKind kind>
+static inline __m128i match16(__m128i v)
+{
+    switch (kind) {
+    case RunKind::Digits:
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    case RunKind::Letters:
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+    default:
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_setzero_si128())),
+                            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    }
+}
+
+template <RunKind kind>
+static size_t sse2Run(const char *p, size_t len)
+{
+    size_t i = 0;
+    for ( ; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        uint32_t miss = ~uint32_t(_mm_movemask_epi8(match16<kind>(v))) & 0xffff;
+        if (miss != 0) {
+            return i + __builtin_ctz(miss);
+        }
+    }
+    return i + scalarRun<kind>(p + i, len - i);
+}
+
+template <RunKind kind>
+__attribute__((target("avx2")))
+static inline __m256i match32(__m256i v)
+{
+    switch (kind) {
+    case RunKind::Digits:
+        return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    case RunKind::Letters:
+        return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), v));
+    default:
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_setzero_si256())),
+                               _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+    }
+}
+
+template <RunKind kind>
+__attribute__((target("avx2")))
+static size_t avx2Run(const char *p, size_t len)
+{
+    size_t i = 0;
+    for ( ; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        uint32_t miss = ~uint32_t(_mm256_movemask_epi8(match32<kind>(v)));
+        if (miss != 0) {
+            return i + __builtin_ctz(miss);
+        }
+    }
+    return i + sse2Run<kind>(p + i, len - i);
+}
+#endif
+
+typedef size_t (*RunFn)(const char*, size_t);
+
+struct ScanTable {
+    const char *name;
+    RunFn digits;
+    RunFn letters;
+    RunFn spaces;
+};
+
+// false if the cpu cannot run the implementation name
+static bool namedScanTable(std::string_view name, ScanTable &table)
+{
+#ifdef PLT_SCAN_X86
+    __builtin_cpu_init();
+    if (name == "avx2" && __builtin_cpu_supports("avx2")) {
+        table = {"avx2", avx2Run<RunKind::Digits>, avx2Run<RunKind::Letters>, avx2Run<RunKind::Spaces>};
+        return true;
+    }
+    if (name == "sse2" && __builtin_cpu_supports("sse2")) {
+        table = {"sse2", sse2Run<RunKind::Digits>, sse2Run<RunKind::Letters>, sse2Run<RunKind::Spaces>};
+        return true;
+    }
+#endif
+    if (name == "scalar") {
+        table = {"scalar", scalarRun<RunKind::Digits>, scalarRun<RunKind::Letters>, scalarRun<RunKind::Spaces>};
+        return true;
+    }
+    return false;
+}
+
+static ScanTable pickScanTable()
+{
+    ScanTable table;
+    for (const char *name : {"avx2", "sse2", "scalar"}) {
+        if (namedScanTable(name, table)) {
+            break;
+        }
+    }
+    return table;
+}
+
+// picked on first use, so lexing in a static constructor is fine too
+static ScanTable &scanTable()
+{
+    static ScanTable table = pickScanTable();
+    return table;
+}
+
+size_t digitRun(const char *p, size_t len)
+{
+    return scanTable().digits(p, len);
+}
+
+size_t letterRun(const char *p, size_t len)
+{
+    return scanTable().letters(p, len);
+}
+
+size_t spaceRun(const char *p, size_t len)
+{
+    return scanTable().spaces(p, len);
+}
+
+const char *scanImpl()
+{
+    return scanTable().name;
+}
+
+bool setScanImpl(const char *name)
+{
+    ScanTable table;
+    if (!namedScanTable(name, table)) {
+        return false;
+    }
+    scanTable() = table;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef PLT_CHAR_SCAN_H
+#define PLT_CHAR_SCAN_H
+
+#include <cstddef>
+
+/* Length of the run of digits, lowercase letters or whitespace (as classifyChar() sees
+ * them) at the start of p[0, len).
+ *
+ * The lexer uses these to take a whole run in one step instead of one readChar() per
+ * byte. 32 (AVX2) or 16 (SSE2) bytes are classified at a time and the end of the run is
+ * the lowest bit of the mask of non-matching bytes. The implementation is picked once,
+ * from what the cpu supports, the scalar loop is the fallback and handles the tails.
+ */
+size_t digitRun(const char *p, size_t len);
+size_t letterRun(const char *p, size_t len);
+size_t spaceRun(const char *p, size_t len);
+
+// "avx2", "sse2" or "scalar"
+const char *scanImpl();
+
+// makes the lexer use the implementation name from now on, for tests and benchmarks, false
+// if the cpu cannot run it. Not thread safe, nothing may be lexing meanwhile
+bool setScanImpl(const char *name);
+
+#endif
\ No newline at end of file
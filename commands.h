@@ -0,0 +1,131 @@
+#ifndef PLT_COMMANDS_H
+#define PLT_COMMANDS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+/* The backslash commands of the input and what they mean to the parser, looked up by a
+ * perfect hash which is computed at compile time.
+ *
+ * commandHash() is FNV-1a over the name, backslash included, starting from a seed, and
+ * CommandSeed is the first seed for which the names of all Commands land in different
+ * slots of CommandSlots. A lookup is thus one pass over the characters, one table load
+ * and one compare, there is no bucket chain and nothing is allocated. Adding a command
+ * only means adding it to Commands, the seed and the table are found again when it
+ * compiles, and a static_assert fails if there is no seed within MaxCommandSeeds.
+ * The same table serves the Lexer, the constexpr one of const_simplify.h, the Parser and
+ * the SymbolTable.
+ */
+
+enum class CommandKind : uint8_t {
+    Frac,       // \frac \dfrac \tfrac
+    Times,      // \cdot \times, an operator like '*'
+    Divide,     // \div, an operator like '/'
+    Left,       // \left, in front of a '('
+    Right,      // \right, in front of the matching ')'
+    Symbol,     // a greek letter, see symbol_table.h
+};
+
+struct Command {
+    std::string_view name;
+    CommandKind kind;
+};
+
+inline constexpr Command Commands[] {
+    {"\\frac", CommandKind::Frac}, {"\\dfrac", CommandKind::Frac}, {"\\tfrac", CommandKind::Frac},
+    {"\\cdot", CommandKind::Times}, {"\\times", CommandKind::Times}, {"\\div", CommandKind::Divide},
+    {"\\left", CommandKind::Left}, {"\\right", CommandKind::Right},
+
+    // the 24 with fixed symbol ids, in their order (\lota is how it has always been spelled)
+    {"\\alpha", CommandKind::Symbol}, {"\\beta", CommandKind::Symbol}, {"\\gamma", CommandKind::Symbol},
+    {"\\delta", CommandKind::Symbol}, {"\\epsilon", CommandKind::Symbol}, {"\\zeta", CommandKind::Symbol},
+    {"\\eta", CommandKind::Symbol}, {"\\theta", CommandKind::Symbol}, {"\\lota", CommandKind::Symbol},
+    {"\\kappa", CommandKind::Symbol}, {"\\lambda", CommandKind::Symbol}, {"\\mu", CommandKind::Symbol},
+    {"\\nu", CommandKind::Symbol}, {"\\xi", CommandKind::Symbol}, {"\\omicron", CommandKind::Symbol},
+    {"\\pi", CommandKind::Symbol}, {"\\rho", CommandKind::Symbol}, {"\\sigma", CommandKind::Symbol},
+    {"\\tau", CommandKind::Symbol}, {"\\upsilon", CommandKind::Symbol}, {"\\phi", CommandKind::Symbol},
+    {"\\chi", CommandKind::Symbol}, {"\\psi", CommandKind::Symbol}, {"\\omega", CommandKind::Symbol},
+
+    // interned on first use, like subscripted symbols
+    {"\\iota", CommandKind::Symbol}, {"\\varepsilon", CommandKind::Symbol}, {"\\vartheta", CommandKind::Symbol},
+    {"\\varpi", CommandKind::Symbol}, {"\\varrho", CommandKind::Symbol}, {"\\varsigma", CommandKind::Symbol},
+    {"\\varphi", CommandKind::Symbol},
+    {"\\Gamma", CommandKind::Symbol}, {"\\Delta", CommandKind::Symbol}, {"\\Theta", CommandKind::Symbol},
+    {"\\Lambda", CommandKind::Symbol}, {"\\Xi", CommandKind::Symbol}, {"\\Pi", CommandKind::Symbol},
+    {"\\Sigma", CommandKind::Symbol}, {"\\Upsilon", CommandKind::Symbol}, {"\\Phi", CommandKind::Symbol},
+    {"\\Psi", CommandKind::Symbol}, {"\\Omega", CommandKind::Symbol},
+};
+
+inline constexpr size_t CommandCount = sizeof(Commands) / sizeof(Commands[0]);
+inline constexpr uint32_t CommandBits = 8;     // 256 slots, a few times the number of commands
+inline constexpr uint32_t MaxCommandSeeds = 100000;
+
+static_assert(CommandCount < 255, "the slots hold the index + 1 in a byte");
+
+constexpr uint32_t commandHash(std::string_view name, uint32_t seed)
+{
+    uint32_t h = seed;
+    for (char c : name) {
+        h = (h ^ uint8_t(c)) * 16777619u;
+    }
+    return h >> (32 - CommandBits);
+}
+
+constexpr bool perfectCommandSeed(uint32_t seed)
+{
+    bool used[1u << CommandBits] {};
+    for (const Command &cmd : Commands) {
+        uint32_t slot = commandHash(cmd.name, seed);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+// the number of seeds tried from the FNV offset basis on, MaxCommandSeeds if none works
+constexpr uint32_t findCommandSeed()
+{
+    uint32_t i = 0;
+    while (i < MaxCommandSeeds && !perfectCommandSeed(2166136261u + i)) {
+        ++i;
+    }
+    return i;
+}
+
+inline constexpr uint32_t CommandSeedOffset = findCommandSeed();
+static_assert(CommandSeedOffset < MaxCommandSeeds, "no perfect hash seed for Commands, raise CommandBits");
+inline constexpr uint32_t CommandSeed = 2166136261u + CommandSeedOffset;
+
+struct CommandTable {
+    uint8_t slots[1u << CommandBits] {};    // index in Commands + 1, 0 if the slot is free
+};
+
+constexpr CommandTable buildCommandTable()
+{
+    CommandTable table;
+    for (size_t i = 0; i < CommandCount; ++i) {
+        table.slots[commandHash(Commands[i].name, CommandSeed)] = uint8_t(i + 1);
+    }
+    return table;
+}
+
+inline constexpr CommandTable CommandSlots = buildCommandTable();
+
+// the index in Commands of the command named text (backslash included), CommandCount if there is none
+constexpr size_t commandIndex(std::string_view text)
+{
+    uint8_t i = CommandSlots.slots[commandHash(text, CommandSeed)];
+    return i != 0 && Commands[i - 1].name == text ? i - 1 : CommandCount;
+}
+
+// the command named text, nullptr if there is none
+constexpr const Command *findCommand(std::string_view text)
+{
+    size_t i = commandIndex(text);
+    return i != CommandCount ? &Commands[i] : nullptr;
+}
+
+#endif
\ No newline at end of file
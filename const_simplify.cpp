@@ -0,0 +1,26 @@
+#include "const_simplify.h"
+
+// compile-time checks of the constexpr pipeline, compiling libplt runs them.
+// The expected values are the ones Session::simplify() gives for testcases/
+
+// test0.tex
+static_assert(cexpr::simplify("\\frac{1}{10}a\\alpha + \\beta").output.view() == "\\frac{1}{10}a\\alpha+\\beta");
+// test1.tex
+static_assert(cexpr::simplify("").error == Error::EmptyString);
+// test2.tex
+static_assert(cexpr::simplify("\\bad + symbol").error == Error::BadSymbol);
+// test3.tex
+static_assert(cexpr::simplify("a\\zeta 1 + b2").error == Error::SyntaxError);
+// test4.tex
+static_assert(cexpr::simplify("\\frac{2 + \\frac{1}{2}}{3}").output.view() == "\\frac{5}{6}");
+// test5.tex
+static_assert(cexpr::simplify("\\frac{3}{4}b-\\frac{1}{2}b").output.view() == "\\frac{1}{4}b");
+// test6.tex
+static_assert(cexpr::simplify("-2a-2b").output.view() == "-2a-2b");
+
+static_assert(PLT_SIMPLIFY("\\frac{1}{2}a+\\frac{1}{3}a").output.view() == "\\frac{5}{6}a");
+static_assert(PLT_SIMPLIFY("(a+b)*(c-d)").exp.numer.size() == 4);
+static_assert(PLT_SIMPLIFY("2*(a+b)/3").exp.numer[1].rational.numer == 2);
+static_assert(cexpr::simplify("\\beta13").error == Error::SyntaxError);
+static_assert(cexpr::simplify("99999999999").error == Error::NumberTooLarge);
+static_assert(cexpr::simplify<4>("a+b+c").error == Error::OutOfMemory);
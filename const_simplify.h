@@ -0,0 +1,828 @@
+#ifndef PLT_CONST_SIMPLIFY_H
+#define PLT_CONST_SIMPLIFY_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "lexer.h"
+#include "parser.h"
+#include "error.h"
+
+/* constexpr version of the lexer -> parser -> calc -> codegen pipeline, for expressions which
+ * are known at build time:
+ *
+ *   constexpr auto res = PLT_SIMPLIFY("\\frac{1}{2}a+\\frac{1}{3}a");
+ *   static_assert(res.output.view() == "\\frac{5}{6}a");
+ *   res.exp.numer[0].rational.numer;      // 5, the sorted coefficient table
+ *
+ * Everything lives in fixed-capacity containers, the capacities are template arguments of
+ * cexpr::simplify(). It follows the runtime classes step by step (the lexer shares its fsm
+ * table with Lexer) and gives the same output and error code as Session::simplify(), except:
+ * - inputs which need more than the capacities return Error::OutOfMemory
+ * - terms with equal monomials keep their order when sorted, std::sort may swap them if there
+ *   are more than 16 terms
+ * - monomials are single words of the 50 fixed symbols, an input with a '_' (subscripted
+ *   symbols, see symbol_table.h) or another greek letter (\Gamma, \varphi, see commands.h)
+ *   returns Error::BadSymbol
+ * - inputs which Session::simplify() refuses with Error::Unsupported (a*a, symbols in a
+ *   divisor, ...) do not compile
+ */
+
+namespace cexpr {
+
+template <typename T, size_t N>
+class FixedVector {
+public:
+    constexpr size_t size() const {return _size;}
+    constexpr bool full() const {return _size == N;}
+    constexpr T &operator[](size_t i) {return _data[i];}
+    constexpr const T &operator[](size_t i) const {return _data[i];}
+    constexpr T *begin() {return _data;}
+    constexpr T *end() {return _data + _size;}
+    constexpr const T *begin() const {return _data;}
+    constexpr const T *end() const {return _data + _size;}
+    constexpr void clear() {_size = 0;}
+
+    constexpr void push_back(const T &val) {
+        assert("Error: FixedVector is full" && _size < N);
+        _data[_size++] = val;
+    }
+
+private:
+    T _data[N] {};
+    size_t _size {0};
+};
+
+// stays NUL terminated, appending to a full string only sets overflow
+template <size_t N>
+class FixedString {
+public:
+    bool overflow {false};
+
+    constexpr size_t size() const {return _size;}
+    constexpr const char *c_str() const {return _data;}
+    constexpr std::string_view view() const {return std::string_view(_data, _size);}
+
+    constexpr void clear() {
+        _size = 0;
+        _data[0] = '\0';
+        overflow = false;
+    }
+
+    constexpr FixedString &operator<<(char c) {
+        if (_size == N) {
+            overflow = true;
+            return *this;
+        }
+        _data[_size++] = c;
+        _data[_size] = '\0';
+        return *this;
+    }
+
+    constexpr FixedString &operator<<(std::string_view str) {
+        for (char c : str) {
+            *this << c;
+        }
+        return *this;
+    }
+
+    constexpr FixedString &operator<<(int num) {
+        char digits[16] {};
+        int len = 0;
+        unsigned int val = num < 0 ? 0u - unsigned(num) : unsigned(num);
+        if (num < 0) {
+            *this << '-';
+        }
+        do {
+            digits[len++] = char('0' + val % 10);
+            val /= 10;
+        } while (val > 0);
+        while (len > 0) {
+            *this << digits[--len];
+        }
+        return *this;
+    }
+
+private:
+    char _data[N + 1] {};
+    size_t _size {0};
+};
+
+inline constexpr std::string_view SymbolPool[24] {
+    "\\alpha", "\\beta", "\\gamma", "\\delta", "\\epsilon", "\\zeta", "\\eta", "\\theta", "\\lota", "\\kappa",
+    "\\lambda", "\\mu", "\\nu", "\\xi", "\\omicron", "\\pi", "\\rho", "\\sigma", "\\tau", "\\upsilon", "\\phi",
+    "\\chi", "\\psi", "\\omega",
+};
+
+// same as Gcd() of utils.h, i.e. std::__gcd, the sign of the result matters for the output
+constexpr int gcd(int m, int n)
+{
+    while (n != 0) {
+        int t = m % n;
+        m = n;
+        n = t;
+    }
+    assert(m != 0);
+    return m;
+}
+
+// see basic_exp.h for the runtime versions of Rational, Term and Exp
+struct Rational {
+    int numer {0};
+    int denom {1};
+
+    constexpr bool positive() const {return denom < 0 ? numer < 0 : numer > 0;}
+
+    friend constexpr Rational operator+(const Rational &ratA, const Rational &ratB) {
+        if (ratA.denom == 1 && ratB.denom == 1) {
+            return {ratA.numer + ratB.numer, 1};
+        }
+        int numer = ratA.numer * ratB.denom + ratA.denom * ratB.numer;
+        if (numer == 0) {
+            return {0, 1};
+        }
+        int denom = ratA.denom * ratB.denom;
+        int g = gcd(numer, denom);
+        return {numer / g, denom / g};
+    }
+
+    friend constexpr Rational operator-(const Rational &ratA, const Rational &ratB) {
+        if (ratA.denom == 1 && ratB.denom == 1) {
+            return {ratA.numer - ratB.numer, 1};
+        }
+        int numer = ratA.numer * ratB.denom - ratA.denom * ratB.numer;
+        if (numer == 0) {
+            return {0, 1};
+        }
+        int denom = ratA.denom * ratB.denom;
+        int g = gcd(numer, denom);
+        return {numer / g, denom / g};
+    }
+
+    friend constexpr Rational operator*(const Rational &ratA, const Rational &ratB) {
+        if (ratA.denom == 1 && ratB.denom == 1) {
+            return {ratA.numer * ratB.numer, 1};
+        }
+        if (ratA.denom == 0 || ratB.denom == 0) {
+            return {0, 1};
+        }
+        int numer = ratA.numer * ratB.numer;
+        int denom = ratA.denom * ratB.denom;
+        int g = gcd(numer, denom);
+        return {numer / g, denom / g};
+    }
+
+    friend constexpr Rational operator/(const Rational &ratA, const Rational &ratB) {
+        if (ratA.denom == 0) {
+            return {0, 1};
+        }
+        int numer = ratA.numer * ratB.denom;
+        if (numer == 0) {
+            return {0, 1};
+        }
+        int denom = ratA.denom * ratB.numer;
+        int g = gcd(numer, denom);
+        return {numer / g, denom / g};
+    }
+
+    template <size_t N>
+    constexpr void CodeGen(FixedString<N> &os) const {
+        int n = denom < 0 ? -numer : numer;
+        int d = denom < 0 ? -denom : denom;
+        if (n < 0) {
+            os << '-';
+        }
+        os << "\\frac{" << (n < 0 ? -n : n) << "}{" << d << "}";
+    }
+};
+
+struct Term {
+    Rational rational;
+    uint64_t symbolTable {0};  // a = 1 << 0, \alpha = 1 << 26
+
+    friend constexpr Term operator-(const Term &term) {
+        return {{-term.rational.numer, term.rational.denom}, term.symbolTable};
+    }
+
+    friend constexpr Term operator*(const Term &termA, const Term &termB) {
+        assert("no same symbols allowed in multiply" && (termA.symbolTable & termB.symbolTable) == 0);
+        return {termA.rational * termB.rational, termA.symbolTable | termB.symbolTable};
+    }
+
+    template <size_t N>
+    constexpr void CodeGen(FixedString<N> &os) const {
+        if (rational.denom == 1) {
+            int n = rational.numer < 0 ? -rational.numer : rational.numer;
+            if (rational.numer < 0) {
+                os << '-';
+            }
+            if (n != 1 || symbolTable == 0) {
+                os << n;
+            }
+        } else {
+            rational.CodeGen(os);
+        }
+        for (char c = 'a'; c <= 'z'; ++c) {
+            if (symbolTable & (1ULL << (c - 'a'))) {
+                os << c;
+            }
+        }
+        for (int i = 0; i < 24; ++i) {
+            if (symbolTable & (1ULL << (26 + i))) {
+                os << SymbolPool[i];
+            }
+        }
+    }
+};
+
+template <size_t MaxTerms>
+class Exp {
+public:
+    FixedVector<Term, MaxTerms> numer;
+    bool overflow {false};  // some result had more than MaxTerms terms
+
+    constexpr void push(const Term &term) {
+        if (numer.full()) {
+            overflow = true;
+            return;
+        }
+        numer.push_back(term);
+    }
+
+    friend constexpr Exp operator-(const Exp &exp) {
+        Exp res;
+        res.overflow = exp.overflow;
+        for (const Term &term : exp.numer) {
+            res.push(-term);
+        }
+        return res;
+    }
+
+    friend constexpr Exp operator+(const Exp &expA, const Exp &expB) {
+        return addSub(expA, expB, false);
+    }
+
+    friend constexpr Exp operator-(const Exp &expA, const Exp &expB) {
+        return addSub(expA, expB, true);
+    }
+
+    friend constexpr Exp operator*(const Exp &expA, const Exp &expB) {
+        Exp res;
+        res.overflow = expA.overflow || expB.overflow;
+        for (const Term &termA : expA.numer) {
+            for (const Term &termB : expB.numer) {
+                res.push(termA * termB);
+            }
+        }
+        return res;
+    }
+
+    friend constexpr Exp operator/(const Exp &expA, const Exp &expB) {
+        assert("no symbols allowed in devisor" && expB.numer.size() == 1 && expB.numer[0].symbolTable == 0);
+        Exp res = expA;
+        res.overflow = expA.overflow || expB.overflow;
+        for (Term &term : res.numer) {
+            term.rational = term.rational / expB.numer[0].rational;
+        }
+        return res;
+    }
+
+    // insertion sort, stable
+    constexpr void ExpSort() {
+        for (size_t i = 1; i < numer.size(); ++i) {
+            Term term = numer[i];
+            size_t j = i;
+            for ( ; j > 0 && term.symbolTable < numer[j - 1].symbolTable; --j) {
+                numer[j] = numer[j - 1];
+            }
+            numer[j] = term;
+        }
+    }
+
+    template <size_t N>
+    constexpr void CodeGen(FixedString<N> &os) const {
+        for (size_t i = 0; i < numer.size(); ++i) {
+            if (i > 0 && numer[i].rational.positive()) {
+                os << '+';
+            }
+            numer[i].CodeGen(os);
+        }
+    }
+
+private:
+    // only the terms of expA are searched for a like term, as in BasicExp
+    static constexpr Exp addSub(const Exp &expA, const Exp &expB, bool sub) {
+        Exp res = expA;
+        res.overflow = expA.overflow || expB.overflow;
+        size_t lenA = expA.numer.size();
+        for (const Term &termB : expB.numer) {
+            size_t i = 0;
+            for ( ; i < lenA; ++i) {
+                if (expA.numer[i].symbolTable == termB.symbolTable) {
+                    res.numer[i].rational = sub ? expA.numer[i].rational - termB.rational
+                                                : expA.numer[i].rational + termB.rational;
+                    break;
+                }
+            }
+            if (i == lenA) {
+                res.push(sub ? -termB : termB);
+            }
+        }
+        return res;
+    }
+};
+
+struct Token {
+    TokenClass cls {TokenClass::EOS};
+    char op {'\0'};             // Operator: the operator ('*' for \cdot), '\0' if the token text is none
+    CommandKind command {CommandKind::Frac};    // Keyword
+    int number {0};             // Number: std::stoi of the token text
+    bool numberTooLarge {false};
+    uint64_t symbolBit {0};     // Symbol
+};
+
+// port of Lexer, _curToken is kept as the runtime one is, including what an error does to it
+template <size_t MaxTokens>
+class Lexer {
+public:
+    static constexpr size_t MaxTokenLength = 64;
+
+    // returns the same code as Lexer::tokenize(), the stream is terminated by EOS
+    constexpr int tokenize(std::string_view input) {
+        State curState = State::Init;
+
+        for (_pos = 0; _pos < input.size(); ++_pos) {
+            curState = readChar(input[_pos], curState);
+        }
+        if (_overflow) {
+            return Error::OutOfMemory;
+        }
+        if (_pos == 0) {
+            return Error::EmptyString;
+        }
+        if (_badSymbol || _subscript) {
+            return Error::BadSymbol;
+        }
+        if (curState == State::Number || curState == State::Symbol) {
+            pushToken(curState);
+        }
+        pushToken(Token());
+        return _overflow ? Error::OutOfMemory : Error::Success;
+    }
+
+    constexpr const FixedVector<Token, MaxTokens> &getStream() const {return _tokenStream;}
+
+private:
+    size_t _pos {0};
+    FixedVector<char, MaxTokenLength> _curToken;
+    FixedVector<Token, MaxTokens> _tokenStream;
+    bool _badSymbol {false};
+    bool _subscript {false};    // subscripted symbols have dynamic ids, they are not supported here
+    bool _overflow {false};
+
+    constexpr std::string_view curToken() const {
+        return std::string_view(_curToken.begin(), _curToken.size());
+    }
+
+    constexpr void addChar(char c) {
+        if (_curToken.full()) {
+            _overflow = true;
+            return;
+        }
+        _curToken.push_back(c);
+    }
+
+    constexpr void pushToken(const Token &token) {
+        if (_tokenStream.full()) {
+            _overflow = true;
+            return;
+        }
+        _tokenStream.push_back(token);
+    }
+
+    constexpr State readChar(char c, State curState) {
+        CharacterType charType = classifyChar(c, curState);
+        if (charType == CharacterType::IllegalChar) {
+            if (curState == State::Init || curState == State::Letter || curState == State::Escape) {
+                _curToken.clear();
+            } else {
+                pushToken(curState);
+            }
+            return State::Init;
+        }
+        uint32_t trans = StateTrans[uint32_t(curState)][uint32_t(charType)];
+        State nxtState = State(PFIRST(trans));
+        switch (Action(PSECOND(trans))) {
+        case Action::DoNothing:
+            break;
+        case Action::AddToken:
+            _subscript = _subscript || c == '_';
+            addChar(c);
+            break;
+        case Action::PushToken:
+            pushToken(curState);
+            break;
+        case Action::PushTokenAndThis:
+            pushToken(curState);
+            pushThis(c);
+            break;
+        case Action::PushThis:
+            pushThis(c);
+            break;
+        case Action::ErrorHandle:
+            if (curState == State::Number || curState == State::Symbol || curState == State::SubscriptEnd) {
+                pushToken(curState);
+            } else {
+                _curToken.clear();
+            }
+            return State::Init;
+        case Action::Subscript:
+            _subscript = true;
+            break;
+        case Action::PushTokenAndAdd:
+            pushToken(curState);
+            addChar(c);
+            break;
+        }
+        return nxtState;
+    }
+
+    constexpr void pushToken(State curState) {
+        std::string_view text = curToken();
+        Token token;
+        if (curState == State::Number) {
+            // std::stoi
+            int64_t val = 0;
+            for (size_t i = 0; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+                val = val * 10 + (text[i] - '0');
+                if (val > INT32_MAX) {
+                    token.numberTooLarge = true;
+                    break;
+                }
+            }
+            token.cls = TokenClass::Number;
+            token.number = int(val);
+            pushToken(token);
+        } else if (curState == State::Symbol) {
+            // the slot index, a pointer compared to nullptr is not a constant expression under -fsanitize
+            size_t index = commandIndex(text);
+            if (index == CommandCount || (Commands[index].kind == CommandKind::Symbol && symbolIndex(text) == 24)) {
+                _badSymbol = true;
+            } else {
+                const Command &cmd = Commands[index];
+                token.cls = commandClass(cmd.kind);
+                token.command = cmd.kind;
+                if (cmd.kind == CommandKind::Times || cmd.kind == CommandKind::Divide) {
+                    token.op = cmd.kind == CommandKind::Times ? '*' : '/';
+                } else if (cmd.kind == CommandKind::Symbol) {
+                    token.symbolBit = 1ULL << (26 + symbolIndex(text));
+                }
+                pushToken(token);
+            }
+        } else if (curState < State::Subscript) {
+            assert("Error: this branch is unavailable" && false);
+        }
+        _curToken.clear();
+    }
+
+    constexpr void pushThis(char c) {
+        addChar(c);
+        std::string_view text = curToken();
+        Token token;
+        token.cls = tokenizeChar(c);
+        if (text.size() == 1) {
+            token.op = c;
+        }
+        if (token.cls == TokenClass::Symbol) {
+            // a longer text is looked up in the symbol pool by SymbsAST and missed
+            token.symbolBit = text.size() == 1 ? 1ULL << (c - 'a') : 1ULL << (26 + symbolIndex(text));
+        }
+        pushToken(token);
+        _curToken.clear();
+    }
+
+    static constexpr size_t symbolIndex(std::string_view text) {
+        size_t i = 0;
+        while (i < 24 && SymbolPool[i] != text) {
+            ++i;
+        }
+        return i;
+    }
+};
+
+// port of Parser, the LL(1) functions evaluate while they parse since calc() visits the
+// nodes in the same order. The first pass only checks the syntax (with the same panic mode
+// recovery, so that the same numbers are reached), the second one evaluates, so nothing is
+// computed for an expression which does not parse, as in Session.
+template <size_t MaxTokens, size_t MaxTerms>
+class Parser {
+public:
+    typedef Exp<MaxTerms> ExpType;
+
+    constexpr Parser(const FixedVector<Token, MaxTokens> &stream) : _stream(stream) {};
+
+    constexpr int parse(ExpType &result) {
+        _eval = false;
+        _pos = 0;
+        parseExpr(result);
+        while (cur().cls != TokenClass::EOS && !_numberTooLarge) {
+            _success = false;
+            _pos++;
+            while (!(tokenKind(cur()) & (FirstExpr | FollowExpr))) {
+                skip();
+            }
+            if (tokenKind(cur()) & FirstExpr) {
+                parseExpr(result);
+            }
+        }
+        if (_numberTooLarge) {
+            return Error::NumberTooLarge;
+        }
+        if (!_success) {
+            return Error::SyntaxError;
+        }
+        _eval = true;
+        _pos = 0;
+        parseExpr(result);
+        return result.overflow ? Error::OutOfMemory : Error::Success;
+    }
+
+private:
+    const FixedVector<Token, MaxTokens> &_stream;
+    size_t _pos {0};
+    bool _success {true};
+    bool _numberTooLarge {false};
+    bool _eval {false};
+
+    constexpr const Token &cur() const {
+        return _pos < _stream.size() ? _stream[_pos] : _stream[_stream.size() - 1];
+    }
+
+    static constexpr uint32_t tokenKind(const Token &token) {
+        switch (token.cls) {
+        case TokenClass::Symbol:
+            return KindSymbol;
+        case TokenClass::Number:
+            return KindNumber;
+        case TokenClass::Keyword:
+            return token.command == CommandKind::Left ? KindLeft : token.command == CommandKind::Right ? KindRight : KindFrac;
+        case TokenClass::Operator:
+            switch (token.op) {
+            case '+':
+                return KindPlus;
+            case '-':
+                return KindMinus;
+            case '*':
+                return KindTimes;
+            case '/':
+                return KindDivide;
+            default:
+                return 0;
+            }
+        case TokenClass::LeftParenthesis:
+            return KindLeftParenthesis;
+        case TokenClass::RightParenthesis:
+            return KindRightParenthesis;
+        case TokenClass::LeftBrace:
+            return KindLeftBrace;
+        case TokenClass::RightBrace:
+            return KindRightBrace;
+        case TokenClass::EOS:
+            return KindEOS;
+        default:
+            return 0;
+        }
+    }
+
+    constexpr bool isKind(uint32_t kinds) const {
+        return tokenKind(cur()) & kinds;
+    }
+
+    constexpr bool sync(uint32_t first, uint32_t follow, bool nullable) {
+        uint32_t accept = nullable ? first | follow : first;
+        if (isKind(accept)) {
+            return true;
+        }
+        _success = false;
+        while (!isKind(first | follow | KindEOS)) {
+            skip();
+        }
+        return isKind(accept);
+    }
+
+    constexpr void skip() {
+        uint32_t depth = 0;
+        do {
+            if (isKind(KindEOS)) {
+                return;
+            }
+            if (isKind(KindLeftParenthesis | KindLeftBrace)) {
+                depth++;
+            } else if (isKind(KindRightParenthesis | KindRightBrace) && depth > 0) {
+                depth--;
+            }
+            _pos++;
+        } while (depth > 0);
+    }
+
+    constexpr void expect(uint32_t kind) {
+        if (isKind(kind)) {
+            _pos++;
+        } else {
+            _success = false;
+        }
+    }
+
+    constexpr void parseExpr(ExpType &acc) {
+        if (!sync(FirstExpr, FollowExpr, false)) {
+            return;
+        }
+        parseTerm(acc);
+        parseExprs(acc);
+    }
+
+    constexpr void parseExprs(ExpType &acc) {
+        if (!sync(FirstExprs, FollowExpr, true) || !isKind(FirstExprs)) {
+            return;
+        }
+        bool sub = isKind(KindMinus);
+        _pos++;
+        if (!_eval) {
+            parseTerm(acc);
+        } else {
+            ExpType tmp = acc;
+            parseTerm(acc);
+            acc = sub ? tmp - acc : tmp + acc;
+        }
+        parseExprs(acc);
+    }
+
+    constexpr void parseTerm(ExpType &acc) {
+        if (!sync(FirstExpr, FollowTerm, false)) {
+            return;
+        }
+        parseUExpr(acc);
+        parseTerms(acc);
+    }
+
+    constexpr void parseTerms(ExpType &acc) {
+        if (!sync(FirstTerms, FollowTerm, true) || !isKind(FirstTerms)) {
+            return;
+        }
+        bool div = isKind(KindDivide);
+        _pos++;
+        if (!_eval) {
+            parseUExpr(acc);
+        } else {
+            ExpType tmp = acc;
+            parseUExpr(acc);
+            acc = div ? tmp / acc : tmp * acc;
+        }
+        parseTerms(acc);
+    }
+
+    constexpr void parseUExpr(ExpType &acc) {
+        if (!sync(FirstExpr, FollowFact, false)) {
+            return;
+        }
+        if (isKind(FirstFact)) {
+            parseFact(acc);
+            return;
+        }
+        bool neg = isKind(KindMinus);
+        _pos++;
+        parseFact(acc);
+        if (_eval && neg) {
+            acc = -acc;
+        }
+    }
+
+    constexpr void parseFact(ExpType &acc) {
+        if (!sync(FirstFact, FollowFact, false)) {
+            return;
+        }
+        if (isKind(KindLeftParenthesis)) {
+            _pos++;
+            parseExpr(acc);
+            expect(KindRightParenthesis);
+        } else if (isKind(KindLeft)) {
+            _pos++;
+            expect(KindLeftParenthesis);
+            parseExpr(acc);
+            expect(KindRight);
+            expect(KindRightParenthesis);
+        } else if (isKind(FirstNum)) {
+            parseNum(acc);
+            parseSymb0(acc);
+        } else {
+            parseSymbs(acc);
+        }
+    }
+
+    constexpr void parseNum(ExpType &acc) {
+        if (!sync(FirstNum, FollowNum, false)) {
+            return;
+        }
+        if (isKind(KindFrac)) {
+            parseFrac(acc);
+            return;
+        }
+        if (_numberTooLarge) {
+            return;     // std::stoi has thrown already, the rest is never parsed
+        }
+        if (cur().numberTooLarge) {
+            _numberTooLarge = true;
+        }
+        if (_eval) {
+            acc = ExpType();
+            acc.push({{cur().number, 1}, 0});
+        }
+        _pos++;
+    }
+
+    constexpr void parseSymbs(ExpType &acc) {
+        if (!sync(FirstSymbs, FollowFact, false)) {
+            return;
+        }
+        if (_eval) {
+            acc = ExpType();
+            acc.push({{1, 1}, cur().symbolBit});
+        }
+        _pos++;
+        parseSymb0(acc);
+    }
+
+    constexpr void parseSymb0(ExpType &acc) {
+        if (!sync(FirstSymbs, FollowFact, true) || !isKind(FirstSymbs)) {
+            return;
+        }
+        if (!_eval) {
+            parseSymbs(acc);
+        } else {
+            ExpType tmp = acc;
+            parseSymbs(acc);
+            acc = tmp * acc;
+        }
+    }
+
+    constexpr void parseFrac(ExpType &acc) {
+        if (!sync(FirstFrac, FollowNum, false)) {
+            return;
+        }
+        _pos++;
+        expect(KindLeftBrace);
+        parseExpr(acc);
+        expect(KindRightBrace);
+        expect(KindLeftBrace);
+        if (!_eval) {
+            parseExpr(acc);
+        } else {
+            ExpType tmp = acc;
+            parseExpr(acc);
+            acc = tmp / acc;
+        }
+        expect(KindRightBrace);
+    }
+};
+
+template <size_t MaxTerms, size_t MaxOutput>
+struct Result {
+    int error {Error::Success};
+    Exp<MaxTerms> exp;              // sorted, as BasicExp after ExpSort()
+    FixedString<MaxOutput> output;  // CodeGen of exp, without the "$ $" of the cli
+};
+
+template <size_t MaxTokens = 256, size_t MaxTerms = 64, size_t MaxOutput = 1024>
+constexpr Result<MaxTerms, MaxOutput> simplify(std::string_view input)
+{
+    Result<MaxTerms, MaxOutput> res;
+    Lexer<MaxTokens> lexer;
+    res.error = lexer.tokenize(input);
+    if (res.error != Error::Success) {
+        return res;
+    }
+    Parser<MaxTokens, MaxTerms> parser(lexer.getStream());
+    res.error = parser.parse(res.exp);
+    if (res.error != Error::Success) {
+        res.exp = Exp<MaxTerms>();
+        return res;
+    }
+    res.exp.ExpSort();
+    res.exp.CodeGen(res.output);
+    if (res.output.overflow) {
+        res.error = Error::OutOfMemory;
+    }
+    return res;
+}
+
+}
+
+// simplified at compile time, an expression which does not simplify does not compile
+#define PLT_SIMPLIFY(str) ([]() { \
+        constexpr auto res = cexpr::simplify(str); \
+        static_assert(res.error == Error::Success, "PLT_SIMPLIFY: " str); \
+        return res; \
+    }())
+
+#endif
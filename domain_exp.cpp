@@ -0,0 +1,249 @@
+#include <charconv>
+#include <algorithm>
+#include "domain_exp.h"
+#include "substitution.h"
+#include "error.h"
+
+// numer / denom in lowest terms with a positive denominator, denom is not 0
+static ExactDomain::Coef normalized(BigInt numer, BigInt denom)
+{
+    if (denom.negative()) {
+        numer = -numer;
+        denom = -denom;
+    }
+    BigInt g = BigInt::gcd(numer, denom);
+    if (g != BigInt(1)) {
+        numer = numer / g;
+        denom = denom / g;
+    }
+    checkCoefficientBits(std::max(numer.bits(), denom.bits()));
+    return ExactDomain::Coef{std::move(numer), std::move(denom)};
+}
+
+ExactDomain::Coef ExactDomain::fromRational(const Rational &rat)
+{
+    if (rat.denom == 0) {
+        return Coef{BigInt(0), BigInt(1)};  // as Rational, which gives 0 for anything over 0
+    }
+    return normalized(BigInt(rat.numer), BigInt(rat.denom));
+}
+
+// integers, the common case, need no gcd
+ExactDomain::Coef ExactDomain::add(const Coef &a, const Coef &b)
+{
+    if (a.denom == BigInt(1) && b.denom == BigInt(1)) {
+        Coef res{a.numer + b.numer, BigInt(1)};
+        checkCoefficientBits(res.numer.bits());
+        return res;
+    }
+    return normalized(a.numer * b.denom + b.numer * a.denom, a.denom * b.denom);
+}
+
+ExactDomain::Coef ExactDomain::sub(const Coef &a, const Coef &b)
+{
+    return add(a, neg(b));
+}
+
+ExactDomain::Coef ExactDomain::mul(const Coef &a, const Coef &b)
+{
+    if (a.denom == BigInt(1) && b.denom == BigInt(1)) {
+        Coef res{a.numer * b.numer, BigInt(1)};
+        checkCoefficientBits(res.numer.bits());
+        return res;
+    }
+    return normalized(a.numer * b.numer, a.denom * b.denom);
+}
+
+bool ExactDomain::div(const Coef &a, const Coef &b, Coef &res)
+{
+    if (b.numer.isZero()) {
+        return false;
+    }
+    res = normalized(a.numer * b.denom, a.denom * b.numer);
+    return true;
+}
+
+void ExactDomain::write(std::ostream &os, const Coef &a)
+{
+    if (a.denom == BigInt(1)) {
+        os << a.numer.toString();
+    } else {
+        os << "\\frac{" << a.numer.toString() << "}{" << a.denom.toString() << "}";
+    }
+}
+
+static_assert(ModularDomain::P * ModularDomain::PInv == ~uint64_t(0), "PInv is -P^-1 mod 2^64");
+
+ModularDomain::Coef ModularDomain::fromRational(const Rational &rat)
+{
+    Coef res;
+    return div(fromInt(rat.numer), fromInt(rat.denom), res) ? res : 0;
+}
+
+// a / b = a * b^(P-2) (Fermat), every term of a Poly is divided by the same b
+bool ModularDomain::div(Coef a, Coef b, Coef &res)
+{
+    static thread_local Coef divisor = fromInt(1), inverse = fromInt(1);
+    if (b == 0) {
+        return false;
+    }
+    if (b != divisor) {
+        divisor = b;
+        inverse = fromInt(1);
+        for (uint64_t e = P - 2; e != 0; e >>= 1) {
+            if (e & 1) {
+                inverse = mul(inverse, b);
+            }
+            b = mul(b, b);
+        }
+    }
+    res = mul(a, inverse);
+    return true;
+}
+
+void ModularDomain::write(std::ostream &os, Coef a)
+{
+    os << toInt(a);
+}
+
+// the shortest text which reads back as the same double
+void DoubleDomain::write(std::ostream &os, Coef a)
+{
+    char num[32];
+    os << std::string(num, std::to_chars(num, num + sizeof(num), a).ptr);
+}
+
+// the orders of BasicExp::ExpSort(), the monomials are distinct
+template <typename Domain>
+void Poly<Domain>::sort(MonomialOrder order)
+{
+    if (order == MonomialOrder::Lex) {
+        std::sort(terms.begin(), terms.end(), [](const Term &a, const Term &b) {
+            return a.second < b.second;
+        });
+    } else if (order == MonomialOrder::GradedLex) {
+        std::sort(terms.begin(), terms.end(), [](const Term &a, const Term &b) {
+            uint32_t degA = a.second.degree(), degB = b.second.degree();
+            return degA != degB ? degA < degB : a.second < b.second;
+        });
+    }
+}
+
+template <typename Domain>
+void Poly<Domain>::CodeGen(std::ostream &os) const
+{
+    bool first = true;
+    for (const Term &term : terms) {
+        if (Domain::isZero(term.first)) {
+            continue;
+        }
+        bool negative = Domain::negative(term.first);
+        if (negative) {
+            os << "-";
+        } else if (!first) {
+            os << "+";
+        }
+        Coef abs = negative ? Domain::neg(term.first) : term.first;
+        if (!Domain::isOne(abs) || term.second.empty()) {
+            Domain::write(os, abs);
+        }
+        writeSymbols(os, term.second);
+        first = false;
+    }
+    if (first) {
+        os << "0";
+    }
+}
+
+template <typename Domain>
+int DomainInterpreter<Domain>::run(const Program &prog, Poly<Domain> &result)
+{
+    _stack.clear();
+    for (const Instruction &ins : prog.code) {
+        Poly<Domain> *top = _stack.empty() ? nullptr : &_stack.back();
+        switch (ins.op) {
+        case OpCode::PushNum:
+            _stack.push_back(Poly<Domain>::constant(Domain::fromRational(Rational(ins.operand, 1))));
+            break;
+        case OpCode::PushSym:
+            if (const BasicExp *value = boundValue(ins.operand)) {
+                _stack.push_back(Poly<Domain>::fromBasic(*value));
+            } else {
+                _stack.emplace_back();
+                _stack.back().terms.emplace_back(Domain::fromRational(Rational(1, 1)), Monomial::symbol(ins.operand));
+            }
+            break;
+        case OpCode::Add:
+            top[-1] = top[-1] + top[0];
+            _stack.pop_back();
+            break;
+        case OpCode::Sub:
+            top[-1] = top[-1] - top[0];
+            _stack.pop_back();
+            break;
+        case OpCode::Mul:
+            top[-1] = top[-1] * top[0];
+            _stack.pop_back();
+            break;
+        case OpCode::Div: {
+            Poly<Domain> res;
+            if (!Poly<Domain>::divide(top[-1], top[0], res)) {
+                return Error::DivisionByZero;
+            }
+            top[-1] = std::move(res);
+            _stack.pop_back();
+            break;
+        }
+        case OpCode::Neg:
+            top[0] = -top[0];
+            break;
+        }
+    }
+    result = std::move(_stack[0]);
+    _stack.clear();
+    return Error::Success;
+}
+
+template class Poly<ExactDomain>;
+template class Poly<ModularDomain>;
+template class Poly<DoubleDomain>;
+template class DomainInterpreter<ExactDomain>;
+template class DomainInterpreter<ModularDomain>;
+template class DomainInterpreter<DoubleDomain>;
+
+template <typename Domain>
+static int evaluateIn(const Program &prog, MonomialOrder order, std::ostream &os)
+{
+    DomainInterpreter<Domain> interpreter;
+    Poly<Domain> result;
+    int ret = interpreter.run(prog, result);
+    if (ret != Error::Success) {
+        return ret;
+    }
+    result.sort(order);
+    result.CodeGen(os);
+    return Error::Success;
+}
+
+int evaluate(const Program &prog, CoefficientDomain domain, MonomialOrder order, std::ostream &os)
+{
+    switch (domain) {
+    case CoefficientDomain::Exact:
+        return evaluateIn<ExactDomain>(prog, order, os);
+    case CoefficientDomain::Modular:
+        return evaluateIn<ModularDomain>(prog, order, os);
+    case CoefficientDomain::Double:
+        return evaluateIn<DoubleDomain>(prog, order, os);
+    default: {
+        Interpreter interpreter;
+        BasicExp result;
+        int ret = interpreter.run(prog, result);
+        if (ret != Error::Success) {
+            return ret;
+        }
+        result.ExpSort(order);
+        result.CodeGen(os);
+        return Error::Success;
+    }
+    }
+}
\ No newline at end of file
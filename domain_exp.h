@@ -0,0 +1,244 @@
+#ifndef PLT_DOMAIN_EXP_H
+#define PLT_DOMAIN_EXP_H
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <iostream>
+#include "basic_exp.h"
+#include "bytecode.h"
+#include "bigint.h"
+#include "budget.h"
+
+/* The algebra of BasicExp over other coefficient rings, for the evaluation of a program
+ * (see bytecode.h) instead of calc():
+ *   ExactDomain      rationals of BigInts, they never overflow
+ *   ModularDomain    Z/pZ for the prime p = 2^62 - 57, in Montgomery form, no division
+ *                    except for the inverse of a divisor
+ *   DoubleDomain     double
+ * A domain is a struct with the type Coef and static functions for the arithmetic, Poly is
+ * instantiated for each, so the coefficient operations are inlined into the term loops.
+ * Modular and double coefficients are never normalised by a gcd, they are meant for fast
+ * screening runs over big batches (does it cancel, is it zero, how many terms).
+ *
+ * Poly keeps the term order and the semantics of BasicExp (a*a and symbols in a divisor are
+ * refused the same way), except that a zero divisor is reported as Error::DivisionByZero
+ * and terms whose coefficient is 0 are left out of the output.
+ */
+
+enum class CoefficientDomain : uint32_t {
+    Int,        // BasicExp, the default
+    Exact,
+    Modular,
+    Double,
+};
+
+struct ExactDomain {
+    struct Coef {
+        BigInt numer;
+        BigInt denom {1};   // positive, coprime to numer
+    };
+
+    static Coef fromRational(const Rational &rat);
+    static Coef add(const Coef &a, const Coef &b);
+    static Coef sub(const Coef &a, const Coef &b);
+    static Coef mul(const Coef &a, const Coef &b);
+    static Coef neg(const Coef &a) {return Coef{-a.numer, a.denom};}
+    static bool div(const Coef &a, const Coef &b, Coef &res);  // false if b is 0
+    static bool isZero(const Coef &a) {return a.numer.isZero();}
+    static bool negative(const Coef &a) {return a.numer.negative();}
+    static bool isOne(const Coef &a) {return a.numer == BigInt(1) && a.denom == BigInt(1);}
+    static void write(std::ostream &os, const Coef &a);     // of |a|, as BasicTerm::CodeGen()
+};
+
+// -p^-1 mod 2^64 for an odd p by Newton's iteration, every step doubles the correct low bits
+constexpr uint64_t montgomeryInverse(uint64_t p)
+{
+    uint64_t inv = p;
+    for (int i = 0; i < 5; ++i) {
+        inv *= 2 - p * inv;
+    }
+    return 0 - inv;
+}
+
+struct ModularDomain {
+    typedef uint64_t Coef;  // a * 2^64 mod P
+
+    static constexpr uint64_t P = (uint64_t(1) << 62) - 57;
+
+    static constexpr uint64_t PInv = montgomeryInverse(P);
+    static constexpr uint64_t R2 = uint64_t(((unsigned __int128)(0 - P) % P) * ((unsigned __int128)(0 - P) % P) % P);
+
+    // t * 2^-64 mod P, for t < P * 2^64
+    static Coef reduce(unsigned __int128 t) {
+        uint64_t m = uint64_t(t) * PInv;
+        uint64_t res = uint64_t((t + (unsigned __int128)m * P) >> 64);
+        return res >= P ? res - P : res;
+    }
+
+    static Coef fromInt(int64_t val) {
+        uint64_t res = val < 0 ? P - (0 - uint64_t(val)) % P : uint64_t(val) % P;
+        return reduce((unsigned __int128)(res == P ? 0 : res) * R2);
+    }
+    static int64_t toInt(Coef a) {      // the representative in (-P/2, P/2]
+        uint64_t val = reduce(a);
+        return val > P / 2 ? -int64_t(P - val) : int64_t(val);
+    }
+
+    static Coef fromRational(const Rational &rat);
+    static Coef add(Coef a, Coef b) {
+        uint64_t res = a + b;
+        return res >= P ? res - P : res;
+    }
+    static Coef sub(Coef a, Coef b) {return a >= b ? a - b : a + P - b;}
+    static Coef mul(Coef a, Coef b) {return reduce((unsigned __int128)a * b);}
+    static Coef neg(Coef a) {return a == 0 ? 0 : P - a;}
+    static bool div(Coef a, Coef b, Coef &res);
+    static bool isZero(Coef a) {return a == 0;}
+    static bool negative(Coef a) {return toInt(a) < 0;}
+    static bool isOne(Coef a) {return toInt(a) == 1;}
+    static void write(std::ostream &os, Coef a);
+};
+
+struct DoubleDomain {
+    typedef double Coef;
+
+    static Coef fromRational(const Rational &rat) {return double(rat.numer) / double(rat.denom);}
+    static Coef add(Coef a, Coef b) {return a + b;}
+    static Coef sub(Coef a, Coef b) {return a - b;}
+    static Coef mul(Coef a, Coef b) {return a * b;}
+    static Coef neg(Coef a) {return -a;}
+    static bool div(Coef a, Coef b, Coef &res) {
+        res = a / b;
+        return b != 0;
+    }
+    static bool isZero(Coef a) {return a == 0;}
+    static bool negative(Coef a) {return a < 0;}
+    static bool isOne(Coef a) {return a == 1;}
+    static void write(std::ostream &os, Coef a);
+};
+
+template <typename Domain>
+class Poly {
+public:
+    typedef typename Domain::Coef Coef;
+    typedef std::pair<Coef, Monomial> Term;
+
+    static constexpr size_t IndexTerms = 32;    // a sum of two polys of this many terms hashes the monomials
+
+    std::vector<Term> terms;
+
+    static Poly constant(const Coef &coef) {
+        Poly res;
+        res.terms.emplace_back(coef, Monomial());
+        return res;
+    }
+
+    static Poly fromBasic(const BasicExp &exp) {
+        Poly res;
+        for (const BasicTerm &term : exp.numer) {
+            res.terms.emplace_back(Domain::fromRational(term.rational), term.monomial);
+        }
+        return res;
+    }
+
+    friend Poly operator-(const Poly &poly) {
+        Poly res;
+        res.terms.reserve(poly.terms.size());
+        for (const Term &term : poly.terms) {
+            res.terms.emplace_back(Domain::neg(term.first), term.second);
+        }
+        return res;
+    }
+
+    friend Poly operator+(const Poly &polyA, const Poly &polyB) {return addSub(polyA, polyB, false);}
+    friend Poly operator-(const Poly &polyA, const Poly &polyB) {return addSub(polyA, polyB, true);}
+
+    friend Poly operator*(const Poly &polyA, const Poly &polyB) {
+        Poly res;
+        checkTerms(polyA.terms.size() * polyB.terms.size());
+        res.terms.reserve(polyA.terms.size() * polyB.terms.size());
+        for (const Term &termA : polyA.terms) {
+            checkDeadline(polyB.terms.size());
+            for (const Term &termB : polyB.terms) {
+                if (!termA.second.disjoint(termB.second)) {
+                    throw UnsupportedOperation();
+                }
+                res.terms.emplace_back(Domain::mul(termA.first, termB.first), termA.second | termB.second);
+            }
+        }
+        return res;
+    }
+
+    // false if the divisor is 0
+    static bool divide(const Poly &polyA, const Poly &polyB, Poly &res) {
+        if (polyB.terms.size() != 1 || !polyB.terms[0].second.empty()) {
+            throw UnsupportedOperation();
+        }
+        res.terms.clear();
+        res.terms.reserve(polyA.terms.size());
+        for (const Term &term : polyA.terms) {
+            Coef coef;
+            if (!Domain::div(term.first, polyB.terms[0].first, coef)) {
+                return false;
+            }
+            res.terms.emplace_back(std::move(coef), term.second);
+        }
+        return true;
+    }
+
+    void sort(MonomialOrder order);
+    void CodeGen(std::ostream &os) const;
+
+private:
+    // as BasicExp: the terms of polyA, then the ones of polyB which polyA does not have
+    static Poly addSub(const Poly &polyA, const Poly &polyB, bool subtract) {
+        size_t lenA = polyA.terms.size();
+        checkDeadline(lenA + polyB.terms.size());
+        Poly res = polyA;
+        std::unordered_map<Monomial, size_t, MonomialHash<1> > index;
+        bool hashed = lenA >= IndexTerms && polyB.terms.size() >= IndexTerms;
+        if (hashed) {
+            index.reserve(lenA);
+            for (size_t i = 0; i < lenA; ++i) {
+                index.emplace(polyA.terms[i].second, i);
+            }
+        }
+        for (const Term &term : polyB.terms) {
+            size_t i = 0;
+            if (hashed) {
+                auto it = index.find(term.second);
+                i = it == index.end() ? lenA : it->second;
+            } else {
+                checkDeadline(lenA);
+                while (i < lenA && polyA.terms[i].second != term.second) {
+                    ++i;
+                }
+            }
+            if (i < lenA) {
+                res.terms[i].first = subtract ? Domain::sub(res.terms[i].first, term.first)
+                                              : Domain::add(res.terms[i].first, term.first);
+            } else {
+                res.terms.emplace_back(subtract ? Domain::neg(term.first) : term.first, term.second);
+            }
+        }
+        checkTerms(res.terms.size());
+        return res;
+    }
+};
+
+// runs a verified program over the domain, bindings (see substitution.h) and budgets apply
+template <typename Domain>
+class DomainInterpreter {
+public:
+    int run(const Program &prog, Poly<Domain> &result);
+
+private:
+    std::vector<Poly<Domain> > _stack;
+};
+
+// writes the CodeGen of prog evaluated over domain, sorted by order
+int evaluate(const Program &prog, CoefficientDomain domain, MonomialOrder order, std::ostream &os);
+
+#endif
\ No newline at end of file
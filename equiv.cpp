@@ -0,0 +1,121 @@
+#include "equiv.h"
+#include "substitution.h"
+#include "error.h"
+
+// the four largest primes below 2^61
+const uint64_t ModularEvaluator::Primes[ModularEvaluator::Rounds] {
+    0x1fffffffffffffffULL, 0x1fffffffffffffe1ULL, 0x1fffffffffffffd3ULL, 0x1fffffffffffff1bULL,
+};
+
+static uint64_t mulMod(uint64_t a, uint64_t b, uint64_t p)
+{
+    return uint64_t((unsigned __int128)a * b % p);
+}
+
+static uint64_t powMod(uint64_t a, uint64_t e, uint64_t p)
+{
+    uint64_t res = 1;
+    for ( ; e != 0; e >>= 1) {
+        if (e & 1) {
+            res = mulMod(res, a, p);
+        }
+        a = mulMod(a, a, p);
+    }
+    return res;
+}
+
+// splitmix64 of the symbol and the round, a fixed seed keeps the answers reproducible
+uint64_t ModularEvaluator::symbolValue(uint32_t id, uint32_t round)
+{
+    uint64_t z = (uint64_t(round) << 32 | id) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return z % Primes[round];
+}
+
+// a bound value at the residues of its symbols, they are not bound again
+static uint64_t boundResidue(const BasicExp &value, uint32_t round)
+{
+    const uint64_t p = ModularEvaluator::Primes[round];
+    uint64_t res = 0;
+    for (const BasicTerm &term : value.numer) {
+        const Rational &rat = term.rational;
+        uint64_t numer = rat.numer < 0 ? p - uint64_t(-int64_t(rat.numer)) % p : uint64_t(rat.numer) % p;
+        uint64_t denom = rat.denom < 0 ? p - uint64_t(-int64_t(rat.denom)) % p : uint64_t(rat.denom) % p;
+        uint64_t coef = mulMod(numer, powMod(denom, p - 2, p), p);
+        term.monomial.forEach([&coef, round, p](uint32_t id) {
+            coef = mulMod(coef, ModularEvaluator::symbolValue(id, round), p);
+        });
+        res = (res + coef) % p;
+    }
+    return res;
+}
+
+int ModularEvaluator::run(const Program &prog, uint32_t round, uint64_t &value)
+{
+    const uint64_t p = Primes[round];
+    size_t top = 0;
+
+    _stack.resize(prog.code.size());
+    for (const Instruction &ins : prog.code) {
+        switch (ins.op) {
+        case OpCode::PushNum:
+            _stack[top++] = uint64_t(uint32_t(ins.operand)) % p;
+            break;
+        case OpCode::PushSym:
+            if (const BasicExp *bound = boundValue(ins.operand)) {
+                _stack[top++] = boundResidue(*bound, round);
+            } else {
+                _stack[top++] = symbolValue(ins.operand, round);
+            }
+            break;
+        case OpCode::Add:
+            top--;
+            _stack[top - 1] = (_stack[top - 1] + _stack[top]) % p;
+            break;
+        case OpCode::Sub:
+            top--;
+            _stack[top - 1] = (_stack[top - 1] + p - _stack[top]) % p;
+            break;
+        case OpCode::Mul:
+            top--;
+            _stack[top - 1] = mulMod(_stack[top - 1], _stack[top], p);
+            break;
+        case OpCode::Div:
+            top--;
+            if (_stack[top] == 0) {
+                return Error::DivisionByZero;
+            }
+            // Fermat, p is prime
+            _stack[top - 1] = mulMod(_stack[top - 1], powMod(_stack[top], p - 2, p), p);
+            break;
+        case OpCode::Neg:
+            _stack[top - 1] = (p - _stack[top - 1]) % p;
+            break;
+        }
+    }
+    value = _stack[0];
+    return Error::Success;
+}
+
+int equivalent(const Program &progA, const Program &progB, bool &equal)
+{
+    ModularEvaluator evaluator;
+    for (uint32_t round = 0; round < ModularEvaluator::Rounds; ++round) {
+        uint64_t valA = 0, valB = 0;
+        int ret = evaluator.run(progA, round, valA);
+        if (ret == Error::Success) {
+            ret = evaluator.run(progB, round, valB);
+        }
+        if (ret != Error::Success) {
+            return ret;
+        }
+        if (valA != valB) {
+            equal = false;
+            return Error::Success;
+        }
+    }
+    equal = true;
+    return Error::Success;
+}
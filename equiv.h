@@ -0,0 +1,35 @@
+#ifndef PLT_EQUIV_H
+#define PLT_EQUIV_H
+
+#include <cstdint>
+#include <vector>
+#include "bytecode.h"
+
+/* Probabilistic equivalence of two expressions (Schwartz-Zippel).
+ *
+ * Both expressions are compiled (see bytecode.h) and evaluated modulo 61-bit primes with
+ * every symbol replaced by a pseudo-random residue, the same one in both programs. Two
+ * different expressions of degree d give the same value with a probability of at most
+ * d / p per round, so after Rounds rounds "equal" is wrong with a negligible probability,
+ * "not equal" is always right. Nothing is expanded, every round is linear in the length
+ * of the programs, and a*a or a symbolic divisor, which calc() refuses, are fine here.
+ */
+class ModularEvaluator {
+public:
+    static constexpr uint32_t Rounds = 4;
+    static const uint64_t Primes[Rounds];
+
+    // the residue of the program in round, Error::DivisionByZero if a divisor is 0, a symbol
+    // bound in a BindingScope (see substitution.h) has the residue of its value
+    int run(const Program &prog, uint32_t round, uint64_t &value);
+
+    static uint64_t symbolValue(uint32_t id, uint32_t round);
+
+private:
+    std::vector<uint64_t> _stack;
+};
+
+// equal is only set if Error::Success is returned
+int equivalent(const Program &progA, const Program &progB, bool &equal);
+
+#endif
@@ -9,6 +9,25 @@ enum Error : uint32_t {
     DigitAfterLetter,
     IllegalCharAfterEscape,
     BadSymbol,
+    IllegalChar,
+    SyntaxError,
+    NumberTooLarge,
+    OutOfMemory,
+    InvalidProgram,
+    BadPointTable,
+    MissingSymbol,
+    BadSubscript,
+    DivisionByZero,
+    BadIdentifier,
+    InvalidBinary,
+    CannotOpenFile,
+    TooManyTerms,
+    CoefficientTooLarge,
+    TooManyNodes,
+    DeadlineExceeded,
+    BadQuery,
+    SpillFailed,
+    Unsupported,
 };
 
 inline std::string dumpError(Error err)
@@ -24,6 +43,44 @@ inline std::string dumpError(Error err)
         return "Illegal Character After \'\\\'";
     case Error::BadSymbol:
         return "Bad Symbol";
+    case Error::IllegalChar:
+        return "Illegal Character";
+    case Error::SyntaxError:
+        return "Syntax Error";
+    case Error::NumberTooLarge:
+        return "Number Too Large";
+    case Error::OutOfMemory:
+        return "Out Of Memory";
+    case Error::InvalidProgram:
+        return "Invalid Program";
+    case Error::BadPointTable:
+        return "Bad Point Table";
+    case Error::MissingSymbol:
+        return "Missing Symbol";
+    case Error::BadSubscript:
+        return "Bad Subscript";
+    case Error::DivisionByZero:
+        return "Division By Zero";
+    case Error::BadIdentifier:
+        return "Bad Identifier";
+    case Error::InvalidBinary:
+        return "Invalid Binary Data";
+    case Error::CannotOpenFile:
+        return "Cannot Open File";
+    case Error::TooManyTerms:
+        return "Too Many Terms";
+    case Error::CoefficientTooLarge:
+        return "Coefficient Too Large";
+    case Error::TooManyNodes:
+        return "Too Many Nodes";
+    case Error::DeadlineExceeded:
+        return "Deadline Exceeded";
+    case Error::BadQuery:
+        return "Bad Query";
+    case Error::SpillFailed:
+        return "Spill Failed";
+    case Error::Unsupported:
+        return "Unsupported Operation";
     default:
         return "Unkown Error";
     }
@@ -0,0 +1,182 @@
+#include <cstdlib>
+#include <charconv>
+#include <sstream>
+#include "eval.h"
+#include "error.h"
+
+int PointTable::readHeader(std::istream &is)
+{
+    symbols.clear();
+    columns.clear();
+    _size = 0;
+    if (!std::getline(is, _line)) {
+        return Error::BadPointTable;
+    }
+    std::istringstream names(_line);
+    std::string name;
+    while (names >> name) {
+        if (SymbolTable::canonical(name).empty()) {
+            return Error::BadPointTable;
+        }
+        uint32_t id = SymbolTable::global().intern(name);
+        if (std::find(symbols.begin(), symbols.end(), id) != symbols.end()) {
+            return Error::BadPointTable;
+        }
+        symbols.push_back(id);
+    }
+    columns.assign(symbols.size(), std::vector<double>(BlockSize));
+    return Error::Success;
+}
+
+// blank lines are skipped, every other line must have exactly one value per column; without
+// columns (an empty header, for a result without symbols) every (blank) line is a point
+int PointTable::readBlock(std::istream &is)
+{
+    _size = 0;
+    while (_size < BlockSize && std::getline(is, _line)) {
+        if (!columns.empty() && _line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        const char *p = _line.c_str();
+        char *end = nullptr;
+        for (size_t j = 0; j < columns.size(); ++j) {
+            columns[j][_size] = strtod(p, &end);
+            if (end == p) {
+                return Error::BadPointTable;
+            }
+            p = end;
+        }
+        while (*p == ' ' || *p == '\t' || *p == '\r') {
+            p++;
+        }
+        if (*p != '\0') {
+            return Error::BadPointTable;
+        }
+        _size++;
+    }
+    return Error::Success;
+}
+
+// slot of the monomial, the steps for it and all its prefixes are added when it is new
+uint32_t Evaluator::plan(const Monomial &monomial, std::unordered_map<Monomial, uint32_t, MonomialHash<1> > &slots,
+                         const std::vector<int> &columnOf)
+{
+    if (monomial.empty()) {
+        return NoSlot;
+    }
+    auto it = slots.find(monomial);
+    if (it != slots.end()) {
+        return it->second;
+    }
+    uint32_t last = monomial.last();
+    Monomial prefix = monomial;
+    prefix.erase(last);
+    uint32_t src = plan(prefix, slots, columnOf);
+    uint32_t dst = slots.size();
+    slots.emplace(monomial, dst);
+    _steps.push_back(Step{dst, src, uint32_t(columnOf[last])});
+    return dst;
+}
+
+int Evaluator::prepare(const BasicExp &exp, const PointTable &table)
+{
+    std::vector<int> columnOf;
+    for (size_t j = 0; j < table.symbols.size(); ++j) {
+        if (table.symbols[j] >= columnOf.size()) {
+            columnOf.resize(table.symbols[j] + 1, -1);
+        }
+        columnOf[table.symbols[j]] = j;
+    }
+
+    _steps.clear();
+    _terms.clear();
+    std::unordered_map<Monomial, uint32_t, MonomialHash<1> > slots;
+    for (const BasicTerm &term : exp.numer) {
+        // like emitC(), the 0a of a-a needs no value of a
+        if (term.rational.numer == 0) {
+            continue;
+        }
+        bool missing = false;
+        term.monomial.forEach([&](uint32_t id) {
+            missing = missing || id >= columnOf.size() || columnOf[id] < 0;
+        });
+        if (missing) {
+            return Error::MissingSymbol;
+        }
+        double coef = double(term.rational.numer) / term.rational.denom;
+        _terms.push_back(Term{coef, plan(term.monomial, slots, columnOf)});
+    }
+    _slots.assign(slots.size() * PointTable::BlockSize, 0.0);
+    return Error::Success;
+}
+
+// the loops over whole blocks have a fixed trip count and no aliasing, they vectorise
+// without runtime checks
+static void multiply(double *__restrict dst, const double *__restrict src, const double *__restrict col)
+{
+    for (size_t i = 0; i < PointTable::BlockSize; ++i) {
+        dst[i] = src[i] * col[i];
+    }
+}
+
+static void addScaled(double *__restrict res, double coef, const double *__restrict mono)
+{
+    for (size_t i = 0; i < PointTable::BlockSize; ++i) {
+        res[i] += coef * mono[i];
+    }
+}
+
+// the values behind table.size() are computed as well, they are never looked at
+void Evaluator::eval(const PointTable &table, double *out)
+{
+    const size_t n = PointTable::BlockSize;
+
+    for (const Step &step : _steps) {
+        const double *col = table.columns[step.column].data();
+        if (step.src == NoSlot) {
+            std::copy(col, col + n, &_slots[step.dst * n]);
+        } else {
+            multiply(&_slots[step.dst * n], &_slots[step.src * n], col);
+        }
+    }
+
+    std::fill(out, out + n, 0.0);
+    for (const Term &term : _terms) {
+        if (term.slot == NoSlot) {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] += term.coef;
+            }
+        } else {
+            addScaled(out, term.coef, &_slots[term.slot * n]);
+        }
+    }
+}
+
+int evalPoints(const BasicExp &exp, std::istream &is, std::ostream &os)
+{
+    PointTable table;
+    Evaluator evaluator;
+    int ret = table.readHeader(is);
+    if (ret != Error::Success) {
+        return ret;
+    }
+    ret = evaluator.prepare(exp, table);
+    if (ret != Error::Success) {
+        return ret;
+    }
+
+    double results[PointTable::BlockSize];
+    std::string buf;
+    char num[32];
+    while ((ret = table.readBlock(is)) == Error::Success && table.size() > 0) {
+        evaluator.eval(table, results);
+        buf.clear();
+        for (size_t i = 0; i < table.size(); ++i) {
+            char *end = std::to_chars(num, num + sizeof(num), results[i]).ptr;
+            buf.append(num, end);
+            buf.push_back('\n');
+        }
+        os << buf;
+    }
+    return ret;
+}
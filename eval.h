@@ -0,0 +1,72 @@
+#ifndef PLT_EVAL_H
+#define PLT_EVAL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include "basic_exp.h"
+
+/* Numeric evaluation of a simplified expression at many points.
+ *
+ * The points are read as a table, a header line with the symbol names ("x y \alpha") and
+ * then one line of whitespace separated values per point. A result without symbols is evaluated
+ * with an empty header line, followed by one (blank) line per point. They are kept column by column
+ * (one array per symbol) and handled in blocks of BlockSize points, so every step of the
+ * evaluation is a plain loop over arrays:
+ *   - every monomial of the expression is the product of a shorter monomial and one column,
+ *     the shorter ones are computed once per block and shared by all the terms using them,
+ *     e.g. ab and abc both start from the product ab,
+ *   - every term then adds coefficient * monomial to the results of the block.
+ */
+
+// one block of points, column j holds the values of the symbol with id symbols[j]
+class PointTable {
+public:
+    static constexpr size_t BlockSize = 256;
+
+    std::vector<uint32_t> symbols;
+    std::vector<std::vector<double> > columns;
+
+    int readHeader(std::istream &is);
+    int readBlock(std::istream &is);     // the next BlockSize points at most, size() is 0 at the end
+    size_t size() const {return _size;}
+
+private:
+    size_t _size {0};
+    std::string _line;
+};
+
+class Evaluator {
+public:
+    // the expression must not change while it is evaluated, all its symbols must be in the table
+    int prepare(const BasicExp &exp, const PointTable &table);
+    void eval(const PointTable &table, double *out);    // out has room for BlockSize results
+
+private:
+    static constexpr uint32_t NoSlot = ~0u;
+
+    struct Step {
+        uint32_t dst;       // slot of the monomial
+        uint32_t src;       // slot of the monomial without its last symbol, NoSlot if that is 1
+        uint32_t column;    // column of the last symbol
+    };
+
+    struct Term {
+        double coef;
+        uint32_t slot;      // NoSlot for a constant
+    };
+
+    std::vector<Step> _steps;       // shorter monomials first
+    std::vector<Term> _terms;
+    std::vector<double> _slots;     // BlockSize values per monomial
+
+    uint32_t plan(const Monomial &monomial, std::unordered_map<Monomial, uint32_t, MonomialHash<1> > &slots,
+                  const std::vector<int> &columnOf);
+};
+
+// reads a whole table from is and writes one value per point and line to os, block by block
+int evalPoints(const BasicExp &exp, std::istream &is, std::ostream &os);
+
+#endif
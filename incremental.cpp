@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <stdexcept>
+#include "incremental.h"
+#include "parser.h"
+#include "error.h"
+
+// the '{' and '}' of a subscript ("x_{12}") are part of the symbol
+static bool inSubscript(const std::string &text, uint32_t i)
+{
+    if (text[i] == '{') {
+        return i > 0 && text[i - 1] == '_';
+    }
+    if (text[i] == '}') {
+        uint32_t j = i;
+        while (j > 0 && text[j - 1] >= '0' && text[j - 1] <= '9') {
+            --j;
+        }
+        return j >= 2 && text[j - 1] == '{' && text[j - 2] == '_';
+    }
+    return false;
+}
+
+// characters which always make up a token on their own
+static bool isSingle(const std::string &text, uint32_t i)
+{
+    char c = text[i];
+    return c == '+' || c == '-' || c == '*' || c == '/' || c == '(' || c == ')' ||
+           ((c == '{' || c == '}') && !inSubscript(text, i));
+}
+
+// after reading one of these characters the fsm is in State::Init with no pending token,
+// unless an error was reported
+static bool isBoundary(const std::string &text, uint32_t i)
+{
+    char c = text[i];
+    return c == ' ' || c == '\0' || c == '\t' || c == '\n' || isSingle(text, i);
+}
+
+// move p to the left until the fsm is in State::Init right in front of it. A single char
+// token at p also works, it flushes whatever is pending, but only if it is not edited (p < limit)
+static uint32_t leftRestart(const std::string &text, uint32_t p, uint32_t limit)
+{
+    while (p > 0 && !isBoundary(text, p - 1) && !(p < limit && isSingle(text, p))) {
+        --p;
+    }
+    return p;
+}
+
+// move q to the right until the tokens from q on are the same in the old and the new text,
+// limit is the first character after the removed part
+static uint32_t rightRestart(const std::string &text, uint32_t q, uint32_t limit)
+{
+    while (q < text.size() && !isSingle(text, q) && !(q > limit && isBoundary(text, q - 1))) {
+        ++q;
+    }
+    return q;
+}
+
+// replace vec[begin, end) by repl, reusing the slots that are already there
+template<typename T>
+static void splice(std::vector<T> &vec, uint32_t begin, uint32_t end, std::vector<T> &repl)
+{
+    uint32_t common = std::min<uint32_t>(end - begin, repl.size());
+    std::move(repl.begin(), repl.begin() + common, vec.begin() + begin);
+    if (repl.size() > common) {
+        vec.insert(vec.begin() + begin + common,
+                   std::make_move_iterator(repl.begin() + common), std::make_move_iterator(repl.end()));
+    } else {
+        vec.erase(vec.begin() + begin + common, vec.begin() + end);
+    }
+}
+
+// move the token spans of every node which is not entirely left of token from by dTok
+static void shiftSpans(BaseAST *node, uint32_t from, int32_t dTok)
+{
+    if (node->tokEnd < from) {
+        return;
+    }
+    if (node->tokBegin >= from) {
+        node->tokBegin += dTok;
+    }
+    node->tokEnd += dTok;
+    node->forEachChild([&](std::unique_ptr<BaseAST> &child) {
+        shiftSpans(child.get(), from, dTok);
+    });
+}
+
+int IncrementalSession::load(const std::string &text)
+{
+    _text = text;
+    _valid = false;
+    _ast = nullptr;
+
+    _lexer.reset();
+    int ret = _lexer.tokenize(_text);
+    if (ret != Error::Success) {
+        return ret;
+    }
+    _lexer.pushEOS();
+    _tokens = _lexer.getStream();
+    _tokenPos = _lexer.getPositions();
+
+    try {
+        _ast = _parser.parse(_tokens);
+    } catch (const std::out_of_range &) {
+        _ast = nullptr;
+        return Error::NumberTooLarge;  // std::stoi in Parser::parseNum
+    }
+    if (!_parser.getSuccess()) {
+        _ast = nullptr;
+        return Error::SyntaxError;
+    }
+    ret = recalc();
+
+    // the lexer recovers from some errors on its own, those cannot be reproduced locally
+    _valid = ret == Error::Success && _lexer.getLexError() == Error::Success;
+    return ret;
+}
+
+int IncrementalSession::edit(uint32_t offset, uint32_t removed, const std::string &inserted)
+{
+    uint32_t oldLen = _text.size();
+    offset = std::min(offset, oldLen);
+    removed = std::min(removed, oldLen - offset);
+
+    if (!_valid) {
+        std::string text = _text;
+        text.replace(offset, removed, inserted);
+        return load(text);
+    }
+
+    // characters [p, q) of the old text are re-lexed, tokens [rTok, kOld) are replaced
+    uint32_t p = leftRestart(_text, offset, offset);
+    uint32_t q = rightRestart(_text, offset + removed, offset + removed);
+    uint32_t rTok = std::lower_bound(_tokenPos.begin(), _tokenPos.end(), p) - _tokenPos.begin();
+    uint32_t kOld = std::lower_bound(_tokenPos.begin(), _tokenPos.end(), q) - _tokenPos.begin();
+    uint32_t eos = _tokens.size() - 1;
+
+    // take at least one old token so that the replaced tokens have a place in the AST
+    if (rTok == kOld) {
+        if (rTok > 0) {
+            p = leftRestart(_text, _tokenPos[rTok - 1], offset);
+            rTok = std::lower_bound(_tokenPos.begin(), _tokenPos.end(), p) - _tokenPos.begin();
+        } else if (kOld < eos) {
+            q = rightRestart(_text, _tokenPos[kOld] + _tokens[kOld].second.length(), offset + removed);
+            kOld = std::lower_bound(_tokenPos.begin(), _tokenPos.end(), q) - _tokenPos.begin();
+        } else {
+            std::string text = _text;
+            text.replace(offset, removed, inserted);
+            return load(text);
+        }
+    }
+
+    int32_t delta = int32_t(inserted.length()) - int32_t(removed);
+    _text.replace(offset, removed, inserted);
+
+    _lexer.reset();
+    if (_lexer.tokenize(_text, p, q + delta) != Error::Success) {
+        // let the full run report the error
+        return load(_text);
+    }
+    std::vector<std::pair<TokenClass, std::string> > newTokens = _lexer.getStream();
+    std::vector<uint32_t> newPos = _lexer.getPositions();
+    int32_t dTok = int32_t(newTokens.size()) - int32_t(kOld - rTok);
+    bool same = dTok == 0 && std::equal(newTokens.begin(), newTokens.end(), _tokens.begin() + rTok);
+
+    splice(_tokenPos, rTok, kOld, newPos);
+    for (uint32_t i = rTok + newPos.size(); i < _tokenPos.size(); ++i) {
+        _tokenPos[i] += delta;
+    }
+    if (same) {
+        // only whitespace changed, so did the positions
+        return Error::Success;
+    }
+    splice(_tokens, rTok, kOld, newTokens);
+
+    int ret = reparse(rTok, kOld, dTok);
+    if (ret != Error::Success) {
+        _valid = false;
+        return ret;
+    }
+    return recalc();
+}
+
+// old tokens [rTok, kOld) have been replaced by kOld - rTok + dTok new ones in _tokens
+int IncrementalSession::reparse(uint32_t rTok, uint32_t kOld, int32_t dTok)
+{
+    // walk down to the deepest Expr which contains all the replaced tokens, the nodes above
+    // it are the ones whose results have to be recomputed
+    std::vector<BaseAST*> path {_ast.get()};
+    std::unique_ptr<BaseAST> *slot = &_ast;
+    size_t depth = 0;   // number of nodes in path above *slot
+    for (BaseAST *node = _ast.get(); node != nullptr; ) {
+        BaseAST *next = nullptr;
+        node->forEachChild([&](std::unique_ptr<BaseAST> &child) {
+            if (next == nullptr && child->tokBegin <= rTok && kOld <= child->tokEnd) {
+                next = child.get();
+                if (dynamic_cast<ExprAST*>(next) != nullptr) {
+                    slot = &child;
+                    depth = path.size();
+                }
+            }
+        });
+        if (next != nullptr) {
+            path.push_back(next);
+        }
+        node = next;
+    }
+
+    // the Expr has to end right in front of the same closing token as before
+    uint32_t end = (*slot)->tokEnd + dTok;
+    std::unique_ptr<ExprAST> expr;
+    try {
+        expr = _parser.parseSubExpr(_tokens, (*slot)->tokBegin);
+        if (_parser.getSuccess() && _parser.getPos() != end) {
+            // the edit changed the nesting, e.g. added or removed a bracket
+            _ast = _parser.parse(_tokens);
+            if (!_parser.getSuccess()) {
+                _ast = nullptr;
+                return Error::SyntaxError;
+            }
+            return Error::Success;
+        }
+    } catch (const std::out_of_range &) {
+        return Error::NumberTooLarge;
+    }
+    if (!_parser.getSuccess()) {
+        // the prefix up to the Expr did not change, a full parse fails at the same token
+        return Error::SyntaxError;
+    }
+
+    if (dTok != 0) {
+        shiftSpans(_ast.get(), kOld, dTok);
+    }
+    *slot = std::move(expr);
+    for (size_t i = 0; i < depth; ++i) {
+        path[i]->invalidate();
+    }
+    return Error::Success;
+}
+
+// Error::Unsupported for a*a or a divisor with symbols, the next edit reloads then
+int IncrementalSession::recalc()
+{
+    BaseAST::memoize = true;
+    try {
+        _ast->calc();
+    } catch (const UnsupportedOperation &) {
+        BaseAST::memoize = false;
+        _valid = false;
+        return Error::Unsupported;
+    }
+    BaseAST::memoize = false;
+    _result = BaseAST::resultExp;
+    return Error::Success;
+}
@@ -0,0 +1,46 @@
+#ifndef PLT_INCREMENTAL_H
+#define PLT_INCREMENTAL_H
+
+#include <memory>
+#include "AST.h"
+#include "lexer.h"
+#include "parser.h"
+
+/* Incremental re-simplification of an edited expression.
+ *
+ * The session keeps the text, the token stream (with character offsets), the AST and the
+ * result of every self-contained AST node from the previous version. An edit
+ *   1. re-lexes only the characters between the nearest lexer restart points around it,
+ *      i.e. positions where the FSM is known to be back in State::Init,
+ *   2. re-parses the smallest Expr (the whole input, a "( )" group or a "\frac" operand)
+ *      that still contains all the replaced tokens,
+ *   3. recomputes the results only on the path from that Expr up to the root, everything
+ *      else is taken from the per-node memo (see BaseAST::memoize).
+ * Whenever one of these steps cannot be done locally (lexer errors, unbalanced edits, ...)
+ * the session falls back to running the whole pipeline again, so the result is always
+ * the same as the one of a full run on text().
+ */
+class IncrementalSession {
+public:
+    int load(const std::string &text);
+    int edit(uint32_t offset, uint32_t removed, const std::string &inserted);
+
+    const std::string &text() const {return _text;}
+    const BasicExp &result() const {return _result;}
+    bool valid() const {return _valid;}
+
+private:
+    std::string _text;
+    std::vector<std::pair<TokenClass, std::string> > _tokens;  // terminated by EOS
+    std::vector<uint32_t> _tokenPos;                            // EOS is at _text.size()
+    std::unique_ptr<BaseAST> _ast {nullptr};
+    BasicExp _result;
+    Lexer _lexer;
+    Parser _parser;
+    bool _valid {false};    // false if the last version had an error, the next edit reloads
+
+    int reparse(uint32_t rTok, uint32_t kOld, int32_t dTok);
+    int recalc();
+};
+
+#endif
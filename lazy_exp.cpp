@@ -0,0 +1,254 @@
+#include "lazy_exp.h"
+#include "substitution.h"
+#include "budget.h"
+
+static size_t saturatedMul(size_t a, size_t b)
+{
+    size_t res;
+    return __builtin_mul_overflow(a, b, &res) ? SIZE_MAX : res;
+}
+
+int32_t LazyExp::node(OpCode op, int32_t operand, int32_t lhs, int32_t rhs)
+{
+    auto ins = _ids.emplace(std::make_tuple(op, operand, lhs, rhs), int32_t(_nodes.size()));
+    if (!ins.second) {
+        return ins.first->second;
+    }
+    size_t bound = 1;
+    switch (op) {
+    case OpCode::Add:
+    case OpCode::Sub:
+        bound = _nodes[lhs].bound + _nodes[rhs].bound;
+        bound = bound < _nodes[lhs].bound ? SIZE_MAX : bound;
+        break;
+    case OpCode::Mul:
+        bound = saturatedMul(_nodes[lhs].bound, _nodes[rhs].bound);
+        break;
+    case OpCode::Div:
+    case OpCode::Neg:
+        bound = _nodes[lhs].bound;
+        break;
+    default:
+        break;
+    }
+    _nodes.push_back(Node{op, operand, lhs, rhs, 0, bound});
+    if (lhs >= 0) {
+        _nodes[lhs].uses++;
+    }
+    if (rhs >= 0) {
+        _nodes[rhs].uses++;
+    }
+    return ins.first->second;
+}
+
+// the program must be verified, see Program::verify()
+void LazyExp::build(const Program &prog)
+{
+    std::vector<int32_t> stack;
+    _nodes.clear();
+    _ids.clear();
+    for (const Instruction &ins : prog.code) {
+        switch (ins.op) {
+        case OpCode::PushNum:
+        case OpCode::PushSym:
+            stack.push_back(node(ins.op, ins.operand, -1, -1));
+            break;
+        case OpCode::Neg:
+            stack.back() = node(ins.op, 0, stack.back(), -1);
+            break;
+        default:
+            int32_t rhs = stack.back();
+            stack.pop_back();
+            stack.back() = node(ins.op, 0, stack.back(), rhs);
+            break;
+        }
+    }
+    _root = stack.back();
+}
+
+// the terms of node id from the terms of its children
+void LazyExp::expand(int32_t id, BasicExp &res)
+{
+    const Node &node = _nodes[id];
+    switch (node.op) {
+    case OpCode::PushNum:
+        res.numer.clear();
+        res.numer.push_back(BasicTerm(Rational(node.operand, 1), Monomial()));
+        break;
+    case OpCode::PushSym:
+        if (const BasicExp *value = boundValue(node.operand)) {
+            res = *value;
+        } else {
+            res.numer.clear();
+            res.numer.push_back(BasicTerm(Rational(1, 1), Monomial::symbol(node.operand)));
+        }
+        break;
+    case OpCode::Add:
+        res = _values[node.lhs] + _values[node.rhs];
+        break;
+    case OpCode::Sub:
+        res = _values[node.lhs] - _values[node.rhs];
+        break;
+    case OpCode::Mul:
+        res = _values[node.lhs] * _values[node.rhs];
+        break;
+    case OpCode::Div:
+        res = _values[node.lhs] / _values[node.rhs];
+        break;
+    case OpCode::Neg:
+        res = -_values[node.lhs];
+        break;
+    }
+}
+
+// the children of a node come before it, so the nodes are expanded in the order of their ids,
+// which is the order the Interpreter computes them in
+void LazyExp::expand(BasicExp &result)
+{
+    _values.resize(_nodes.size());
+    _pending.resize(_nodes.size());
+    for (size_t id = 0; id < _nodes.size(); ++id) {
+        _pending[id] = _nodes[id].uses;
+    }
+    for (size_t id = 0; id < _nodes.size(); ++id) {
+        expand(id, _values[id]);
+        for (int32_t child : {_nodes[id].lhs, _nodes[id].rhs}) {
+            if (child >= 0 && --_pending[child] == 0) {
+                BasicExp().numer.swap(_values[child].numer);    // frees it
+            }
+        }
+    }
+    result.numer.clear();
+    result.numer.swap(_values[_root].numer);
+    _values.clear();
+}
+
+// the term through the transforms up to the root, then into out
+void LazyExp::pass(BasicTerm &&term, int32_t transform, SpilledExp &out)
+{
+    while (transform >= 0) {
+        const Transform &trans = _transforms[transform];
+        const BasicExp &factor = _values[trans.factor];
+        if (trans.op == OpCode::Neg) {
+            term = -term;
+        } else if (trans.op == OpCode::Div) {
+            term.rational = term.rational / factor.numer[0].rational;
+        } else {
+            checkDeadline(factor.numer.size());
+            for (const BasicTerm &other : factor.numer) {
+                pass(term * other, trans.parent, out);
+            }
+            return;
+        }
+        transform = trans.parent;
+    }
+    out.put(std::move(term));
+}
+
+void LazyExp::stream(SpilledExp &out, size_t maxTerms)
+{
+    enum : uint8_t {Streamed = 1, Expanded = 2};
+    std::vector<uint8_t> role(_nodes.size(), 0);
+    auto mark = [this, &role, maxTerms](int32_t id) {
+        role[id] |= _nodes[id].bound > maxTerms ? Streamed : Expanded;
+    };
+
+    // parents before their children, an expanded node needs its children expanded
+    mark(_root);
+    for (size_t id = _nodes.size(); id-- > 0; ) {
+        const Node &node = _nodes[id];
+        if (role[id] & Expanded) {
+            for (int32_t child : {node.lhs, node.rhs}) {
+                if (child >= 0) {
+                    role[child] |= Expanded;
+                }
+            }
+        } else if (role[id] & Streamed) {
+            if (node.op == OpCode::Mul) {
+                bool lhsLarger = _nodes[node.lhs].bound >= _nodes[node.rhs].bound;
+                mark(lhsLarger ? node.lhs : node.rhs);
+                role[lhsLarger ? node.rhs : node.lhs] |= Expanded;
+            } else if (node.op == OpCode::Div) {
+                mark(node.lhs);
+                role[node.rhs] |= Expanded;
+            } else {
+                for (int32_t child : {node.lhs, node.rhs}) {
+                    if (child >= 0) {
+                        mark(child);
+                    }
+                }
+            }
+        }
+    }
+
+    // the expanded nodes as in expand(), the ones a streamed node uses are kept to the end
+    _values.resize(_nodes.size());
+    _pending.assign(_nodes.size(), 0);
+    for (size_t id = 0; id < _nodes.size(); ++id) {
+        if (role[id] != 0) {
+            for (int32_t child : {_nodes[id].lhs, _nodes[id].rhs}) {
+                if (child >= 0 && (role[child] & Expanded)) {
+                    _pending[child]++;
+                }
+            }
+        }
+    }
+    for (size_t id = 0; id < _nodes.size(); ++id) {
+        if (!(role[id] & Expanded)) {
+            continue;
+        }
+        expand(id, _values[id]);
+        for (int32_t child : {_nodes[id].lhs, _nodes[id].rhs}) {
+            if (child >= 0 && --_pending[child] == 0) {
+                BasicExp().numer.swap(_values[child].numer);
+            }
+        }
+    }
+
+    // the streamed nodes from the root down, with the transforms of their parents
+    std::vector<std::pair<int32_t, int32_t> > todo {{_root, -1}};
+    _transforms.clear();
+    while (!todo.empty()) {
+        int32_t id = todo.back().first, transform = todo.back().second;
+        todo.pop_back();
+        const Node &node = _nodes[id];
+        if (role[id] & Expanded) {
+            for (const BasicTerm &term : _values[id].numer) {
+                pass(BasicTerm(term), transform, out);
+            }
+            continue;
+        }
+        switch (node.op) {
+        case OpCode::Add:
+            todo.emplace_back(node.rhs, transform);
+            todo.emplace_back(node.lhs, transform);
+            break;
+        case OpCode::Sub:
+            _transforms.push_back(Transform{OpCode::Neg, transform, -1});
+            todo.emplace_back(node.rhs, int32_t(_transforms.size() - 1));
+            todo.emplace_back(node.lhs, transform);
+            break;
+        case OpCode::Neg:
+            _transforms.push_back(Transform{OpCode::Neg, transform, -1});
+            todo.emplace_back(node.lhs, int32_t(_transforms.size() - 1));
+            break;
+        case OpCode::Div:
+            if (_values[node.rhs].numer.size() != 1 || !_values[node.rhs].numer[0].monomial.empty()) {
+                throw UnsupportedOperation();
+            }
+            _transforms.push_back(Transform{OpCode::Div, transform, node.rhs});
+            todo.emplace_back(node.lhs, int32_t(_transforms.size() - 1));
+            break;
+        case OpCode::Mul: {
+            bool lhsLarger = _nodes[node.lhs].bound >= _nodes[node.rhs].bound;
+            _transforms.push_back(Transform{OpCode::Mul, transform, lhsLarger ? node.rhs : node.lhs});
+            todo.emplace_back(lhsLarger ? node.lhs : node.rhs, int32_t(_transforms.size() - 1));
+            break;
+        }
+        default:
+            break;  // a leaf has one term, it is always expanded
+        }
+    }
+    _transforms.clear();
+    _values.clear();
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef PLT_LAZY_EXP_H
+#define PLT_LAZY_EXP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <tuple>
+#include "bytecode.h"
+#include "spill.h"
+
+/* An expression whose products and sums are kept as a dag until its terms are needed.
+ *
+ * build() turns a verified program (see bytecode.h) into nodes instead of running it, every
+ * instruction only adds a node, and equal nodes are shared (hash-consed by opcode, operand and
+ * children), e.g. the (a+b+c)(d+e) of (a+b+c)(d+e)+(a+b+c)(d+e)f is one node. Until expand()
+ * the memory is that of the factored expression, and termBound() costs nothing.
+ *
+ * expand() computes the terms with the BasicExp operators in the order the Interpreter
+ * applies them, so the result is the same, bindings and budgets included. Every node is
+ * expanded once, a shared one is kept until its last parent has used it and freed then.
+ *
+ * stream() is an expand() for results which do not fit in memory (see spill.h): the nodes
+ * of more than maxTerms terms (by their bound) are not expanded but stream their terms into
+ * a SpilledExp. A streamed sum or negation passes the terms of its operands on, a streamed
+ * quotient divides them by its divisor, a streamed product expands its smaller factor only
+ * and passes every term of the other one on multiplied by each term of it. The terms are
+ * the ones of expand(), only like terms are combined in the runs instead of by the sums.
+ */
+class LazyExp {
+public:
+    void build(const Program &prog);
+    void expand(BasicExp &result);
+    void stream(SpilledExp &out, size_t maxTerms);
+
+    size_t size() const {return _nodes.size();}
+    size_t termBound() const {return _root < 0 ? 0 : _nodes[_root].bound;}    // of expand(), without bindings
+
+private:
+    struct Node {
+        OpCode op;
+        int32_t operand;    // of PUSH_NUM and PUSH_SYM
+        int32_t lhs;        // -1 for PUSH_NUM and PUSH_SYM
+        int32_t rhs;        // -1 if there is no second operand
+        uint32_t uses;      // number of parents
+        size_t bound;       // terms after expansion at most, saturated at SIZE_MAX
+    };
+
+    std::vector<Node> _nodes;
+    std::map<std::tuple<OpCode, int32_t, int32_t, int32_t>, int32_t> _ids;
+    std::vector<BasicExp> _values;      // terms of the nodes whose parents are not all expanded yet
+    std::vector<uint32_t> _pending;     // parents which are not expanded yet
+
+    // what a streamed node does to the terms of its operand on their way to the root
+    struct Transform {
+        OpCode op;          // Neg, Div or Mul
+        int32_t parent;     // the transform of the node itself, -1 for the root
+        int32_t factor;     // the expanded divisor or factor of Div and Mul
+    };
+    std::vector<Transform> _transforms;
+    int32_t _root {-1};
+
+    int32_t node(OpCode op, int32_t operand, int32_t lhs, int32_t rhs);
+    void expand(int32_t id, BasicExp &res);
+    void pass(BasicTerm &&term, int32_t transform, SpilledExp &out);
+};
+
+#endif
\ No newline at end of file
@@ -1,16 +1,17 @@
 #include <cassert>
 #include "lexer.h"
 #include "error.h"
+#include "symbol_table.h"
+#include "char_scan.h"
 
 int Lexer::tokenize(const std::string &iString)
 {
-    uint32_t len = iString.size();
-    State curState = State::Init;
+    return tokenize(iString.data(), iString.size());
+}
 
-    for (; _pos < len; ++_pos) {
-        char c = iString[_pos];
-        curState = readChar(c, curState);
-    }
+int Lexer::tokenize(const char *input, size_t len)
+{
+    State curState = scan(input, len, State::Init);
 
     return postTokenize(curState);
 }
@@ -34,18 +35,113 @@ int Lexer::tokenize(std::ifstream &iFile)
     return postTokenize(curState);
 }
 
+// tokenize iString[begin, end) only, the positions of the tokens are still absolute offsets
+// in iString. The range must start in State::Init, i.e. at 0 or right after a whitespace,
+// operator or bracket, so that the tokens match the ones a full tokenize would produce.
+// Nothing is printed, errors are only returned.
+int Lexer::tokenize(const std::string &iString, uint32_t begin, uint32_t end)
+{
+    bool quiet = _quiet;
+
+    _quiet = true;  // the caller decides whether the errors are worth a full run
+    _pos = begin;
+    State curState = scan(iString.data(), end, State::Init);
+    _quiet = quiet;
+
+    if (curState == State::Number || curState == State::Symbol || curState == State::SubscriptEnd) {
+        pushToken(curState);
+    } else if (curState == State::Subscript || curState == State::SubscriptBrace) {
+        return Error::BadSubscript;
+    } else if (curState == State::Escape) {
+        // the '\' is followed by something outside the range, let the caller re-lex more
+        return Error::IllegalCharAfterEscape;
+    }
+    if (!_badSymbol.empty()) {
+        return Error::BadSymbol;
+    }
+
+    return _lexError;
+}
+
+// the parser needs the stream to be terminated by EOS
+void Lexer::pushEOS()
+{
+    _tokenStream.push_back(std::make_pair(TokenClass::EOS, "$"));
+    _tokenPos.push_back(_pos);
+}
+
+// a token which was lexed before, e.g. read by TokenView (binary_format.h)
+void Lexer::push(TokenClass cls, std::string_view text, uint32_t pos)
+{
+    _tokenStream.push_back(std::make_pair(cls, std::string(text)));
+    _tokenPos.push_back(pos);
+    _pos = pos + text.size();
+}
+
+// make the lexer ready for the next input, the buffers keep their capacity
+void Lexer::reset()
+{
+    _pos = 0;
+    _curToken.clear();
+    _tokenStream.clear();
+    _tokenPos.clear();
+    _badSymbol.clear();
+    _lexError = Error::Success;
+}
+
+// readChar() for every char of input[_pos, end), except that the runs which do not need the
+// fsm are taken at once (see char_scan.h): whitespace between tokens, the digits of a number,
+// the letters of a command, and single letter symbols. The tokens and errors are the same.
+State Lexer::scan(const char *input, uint32_t end, State curState)
+{
+    while (_pos < end) {
+        CharacterType charType = classifyChar(input[_pos]);
+        size_t run;
+        if (charType == CharacterType::WhiteSpace && curState == State::Init) {
+            _pos += spaceRun(input + _pos, end - _pos);
+        } else if (charType == CharacterType::Digit && (curState == State::Init || curState == State::Number)) {
+            run = digitRun(input + _pos, end - _pos);
+            _curToken.append(input + _pos, run);
+            _pos += run;
+            curState = State::Number;
+        } else if (charType == CharacterType::Letter && (curState == State::Escape || curState == State::Symbol)) {
+            run = letterRun(input + _pos, end - _pos);
+            _curToken.append(input + _pos, run);
+            _pos += run;
+            curState = State::Symbol;
+        } else if (charType == CharacterType::Letter && (curState == State::Init || curState == State::Letter)) {
+            for (run = letterRun(input + _pos, end - _pos); run > 0; --run, ++_pos) {
+                pushThis(input[_pos]);
+            }
+            curState = State::Letter;
+        } else {
+            curState = readChar(input[_pos], curState);
+            ++_pos;
+        }
+    }
+    return curState;
+}
+
 State Lexer::readChar(char c, State curState)
 {
-    CharacterType charType = classifyChar(c);
+    CharacterType charType = classifyChar(c, curState);
     if (charType == CharacterType::IllegalChar) {
-        printf("illegal char at position %d: %c\n", _pos, c);
-        pushToken(curState);
+        if (!_quiet) {
+            printf("illegal char at position %d: %c\n", _pos, c);
+        }
+        if (_lexError == Error::Success) {
+            _lexError = Error::IllegalChar;
+        }
+        if (curState == State::Init || curState == State::Letter || curState == State::Escape) {
+            _curToken.clear();      // nothing or a lone '\' is in progress
+        } else {
+            pushToken(curState);
+        }
         return State::Init;
     }
-    auto it =  _stateTrans.find(PAIR(curState, charType));
-    assert("Error: no state transform info" && it != _stateTrans.end());
-    State nxtState = State(PFIRST(it->second));
-    Action action = Action(PSECOND(it->second));
+    uint32_t trans = StateTrans[uint32_t(curState)][uint32_t(charType)];
+    State nxtState = State(PFIRST(trans));
+    Action action = Action(PSECOND(trans));
     switch (action) {
     case Action::DoNothing:
         break;
@@ -62,8 +158,28 @@ State Lexer::readChar(char c, State curState)
         pushThis(c);
         break;
     case Action::ErrorHandle:
-        printf("Error: %s at position %d: \'%c\'\n", dumpError(Error(nxtState)).c_str(), _pos, c);
+        if (!_quiet) {
+            printf("Error: %s at position %d: \'%c\'\n", dumpError(Error(nxtState)).c_str(), _pos, c);
+        }
+        if (_lexError == Error::Success) {
+            _lexError = Error(nxtState);
+        }
+        if (curState == State::Number || curState == State::Symbol || curState == State::SubscriptEnd) {
+            pushToken(curState);    // the token is complete, as a letter before a digit is
+        } else {
+            _curToken.clear();      // a lone '\', or a symbol with its incomplete subscript
+        }
         return State::Init;
+    case Action::PushTokenAndAdd:
+        pushToken(curState);
+        _curToken.push_back(c);
+        break;
+    case Action::Subscript:
+        _curToken = _tokenStream.back().second;
+        _tokenStream.pop_back();
+        _tokenPos.pop_back();
+        _curToken.push_back(c);
+        break;
     default:
         assert("Error: this branch is unavailable" && false);
     }
@@ -77,17 +193,27 @@ int Lexer::postTokenize(State curState)
     }
 
     if (!_badSymbol.empty()) {
-        printf("Bad Symbols:\n");
-        int len = _badSymbol.size();
-        for (int i = 0; i < len; ++i) {
-            printf("  %s at position %d\n", _badSymbol[i].first.c_str(), _badSymbol[i].second);
+        if (!_quiet) {
+            printf("Bad Symbols:\n");
+            int len = _badSymbol.size();
+            for (int i = 0; i < len; ++i) {
+                printf("  %s at position %d\n", _badSymbol[i].first.c_str(), _badSymbol[i].second);
+            }
         }
         return Error::BadSymbol;
     }
 
     // in case there is no whitespace at the end of the string
-    if (curState == State::Number || curState == State::Symbol) {
+    if (curState == State::Number || curState == State::Symbol || curState == State::SubscriptEnd) {
         pushToken(curState);
+    } else if (curState == State::Subscript || curState == State::SubscriptBrace) {
+        if (!_quiet) {
+            printf("Error: %s at position %d: \'%s\'\n", dumpError(Error::BadSubscript).c_str(), _pos, _curToken.c_str());
+        }
+        if (_lexError == Error::Success) {
+            _lexError = Error::BadSubscript;
+        }
+        _curToken.clear();
     }
 
     return 0;
@@ -97,11 +223,19 @@ inline void Lexer::pushToken(State curState)
 {
     if (curState == State::Number) {
         _tokenStream.push_back(std::make_pair(TokenClass::Number, _curToken));
+        _tokenPos.push_back(_pos - _curToken.length());
     } else if (curState == State::Symbol) {
-        if (_keywordPool.find(_curToken) != _keywordPool.end()) {
-            _tokenStream.push_back(std::make_pair(TokenClass::Keyword, _curToken));
-        } else if (_symbolPool.find(_curToken) != _symbolPool.end()) {
+        if (const Command *cmd = findCommand(_curToken)) {
+            _tokenStream.push_back(std::make_pair(commandClass(cmd->kind), _curToken));
+            _tokenPos.push_back(_pos - _curToken.length());
+        } else {
+            _badSymbol.push_back(std::make_pair(_curToken, _pos - _curToken.length()));
+        }
+    } else if (curState >= State::Subscript) {
+        // the brackets of "x_{1}" are only checked here, an incomplete one is cut by an illegal char
+        if (curState == State::SubscriptEnd && !SymbolTable::canonical(_curToken).empty()) {
             _tokenStream.push_back(std::make_pair(TokenClass::Symbol, _curToken));
+            _tokenPos.push_back(_pos - _curToken.length());
         } else {
             _badSymbol.push_back(std::make_pair(_curToken, _pos - _curToken.length()));
         }
@@ -115,6 +249,7 @@ inline void Lexer::pushThis(char c)
 {
     _curToken.push_back(c);
     _tokenStream.push_back(std::make_pair(tokenizeChar(c), _curToken));
+    _tokenPos.push_back(_pos);
     _curToken.clear();
 }
 
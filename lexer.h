@@ -3,11 +3,11 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <fstream>
-#include <unordered_map>
-#include <unordered_set>
 #include "error.h"
+#include "commands.h"
 
 // fsm for lexer
 enum class State:uint32_t {
@@ -16,6 +16,9 @@ enum class State:uint32_t {
     Letter,
     Escape,
     Symbol,
+    Subscript,          // after the '_' of a symbol
+    SubscriptBrace,     // in the "{ }" of a subscript
+    SubscriptEnd,       // after a whole subscript, the symbol is not pushed yet
 };
 
 enum class CharacterType:uint32_t {
@@ -25,6 +28,7 @@ enum class CharacterType:uint32_t {
     WhiteSpace,
     Operator,
     Bracket,
+    Underscore,
 
     IllegalChar,
 };
@@ -36,14 +40,16 @@ enum class Action:uint32_t {
     PushTokenAndThis,
     PushThis,
     ErrorHandle,
+    Subscript,          // take the last pushed symbol back, a subscript follows
+    PushTokenAndAdd,    // push the pending token, this char starts the next one
 };
 //fsm end
 
 enum class TokenClass:uint32_t {
-    Symbol,             // a b ... z alpha beta ... zeta
+    Symbol,             // a b ... z alpha beta ... zeta, each may have a subscript: x_1 x_{12}
     Number,
-    Keyword,            // 'frac'
-    Operator,           // + - * /
+    Keyword,            // \frac \dfrac \tfrac \left \right, see commands.h
+    Operator,           // + - * / \cdot \times \div
     LeftParenthesis,    // (
     RightParenthesis,   // )
     LeftBrace,          // {
@@ -53,113 +59,180 @@ enum class TokenClass:uint32_t {
     UnknownClass,
 };
 
+// fsm transitions, indexed by [State][CharacterType], PAIR(next state, action)
+// the next state of Action::ErrorHandle is the Error to report
+#define PAIR(x, y) (uint32_t(x) << 16 | uint32_t(y))
+#define PFIRST(x) ((uint32_t(x) >> 16) & 0x0000ffff)
+#define PSECOND(x) (uint32_t(x) & 0x0000ffff)
+inline constexpr uint32_t StateTrans[8][7] {
+    {   // State::Init
+        PAIR(State::Number, Action::AddToken),          // Digit
+        PAIR(State::Letter, Action::PushThis),          // Letter
+        PAIR(State::Escape, Action::AddToken),          // EscapeChar
+        PAIR(State::Init, Action::DoNothing),           // WhiteSpace
+        PAIR(State::Init, Action::PushThis),            // Operator
+        PAIR(State::Init, Action::PushThis),            // Bracket
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Underscore
+    },
+    {   // State::Number
+        PAIR(State::Number, Action::AddToken),          // Digit
+        PAIR(State::Letter, Action::PushTokenAndThis),  // Letter
+        PAIR(State::Escape, Action::PushTokenAndAdd),   // EscapeChar
+        PAIR(State::Init, Action::PushToken),           // WhiteSpace
+        PAIR(State::Init, Action::PushTokenAndThis),    // Operator
+        PAIR(State::Init, Action::PushTokenAndThis),    // Bracket
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Underscore
+    },
+    {   // State::Letter
+        PAIR(Error::DigitAfterLetter, Action::ErrorHandle), // Digit
+        PAIR(State::Letter, Action::PushThis),          // Letter
+        PAIR(State::Escape, Action::AddToken),          // EscapeChar
+        PAIR(State::Init, Action::DoNothing),           // WhiteSpace
+        PAIR(State::Init, Action::PushThis),            // Operator
+        PAIR(State::Init, Action::PushThis),            // Bracket
+        PAIR(State::Subscript, Action::Subscript),      // Underscore
+    },
+    {   // State::Escape
+        PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle), // Digit
+        PAIR(State::Symbol, Action::AddToken),          // Letter
+        PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle), // EscapeChar
+        PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle), // WhiteSpace
+        PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle), // Operator
+        PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle), // Bracket
+        PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle), // Underscore
+    },
+    {   // State::Symbol
+        PAIR(Error::DigitAfterLetter, Action::ErrorHandle), // Digit
+        PAIR(State::Symbol, Action::AddToken),          // Letter
+        PAIR(State::Escape, Action::PushTokenAndAdd),   // EscapeChar
+        PAIR(State::Init, Action::PushToken),           // WhiteSpace
+        PAIR(State::Init, Action::PushTokenAndThis),    // Operator
+        PAIR(State::Init, Action::PushTokenAndThis),    // Bracket
+        PAIR(State::Subscript, Action::AddToken),       // Underscore
+    },
+    {   // State::Subscript, one digit or a '{'
+        PAIR(State::SubscriptEnd, Action::AddToken),    // Digit
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Letter
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // EscapeChar
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // WhiteSpace
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Operator
+        PAIR(State::SubscriptBrace, Action::AddToken),  // Bracket
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Underscore
+    },
+    {   // State::SubscriptBrace, digits up to the '}'
+        PAIR(State::SubscriptBrace, Action::AddToken),  // Digit
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Letter
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // EscapeChar
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // WhiteSpace
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Operator
+        PAIR(State::SubscriptEnd, Action::AddToken),    // Bracket
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Underscore
+    },
+    {   // State::SubscriptEnd, the brackets are checked when the symbol is pushed
+        PAIR(Error::DigitAfterLetter, Action::ErrorHandle), // Digit
+        PAIR(State::Letter, Action::PushTokenAndThis),  // Letter
+        PAIR(State::Escape, Action::PushTokenAndAdd),   // EscapeChar
+        PAIR(State::Init, Action::PushToken),           // WhiteSpace
+        PAIR(State::Init, Action::PushTokenAndThis),    // Operator
+        PAIR(State::Init, Action::PushTokenAndThis),    // Bracket
+        PAIR(Error::BadSubscript, Action::ErrorHandle), // Underscore
+    },
+};
+
+constexpr CharacterType classifyChar(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return CharacterType::Digit;
+    }
+    if (c >= 'a' && c <= 'z') {
+        return CharacterType::Letter;
+    }
+    if (c == '\\') {
+        return CharacterType::EscapeChar;
+    }
+    if (c == ' ' || c == '\0' || c == '\t' || c == '\n') {
+        return CharacterType::WhiteSpace;
+    }
+    if (c == '+' || c == '-' || c == '*' || c == '/') {
+        return CharacterType::Operator;
+    }
+    if (c == '{' || c == '}' || c == '(' || c == ')') {
+        return CharacterType::Bracket;
+    }
+    if (c == '_') {
+        return CharacterType::Underscore;
+    }
+    return CharacterType::IllegalChar;
+}
+
+// uppercase letters only occur in commands (\Gamma), anywhere else they are illegal
+constexpr CharacterType classifyChar(char c, State curState)
+{
+    if (c >= 'A' && c <= 'Z' && (curState == State::Escape || curState == State::Symbol)) {
+        return CharacterType::Letter;
+    }
+    return classifyChar(c);
+}
+
+constexpr TokenClass commandClass(CommandKind kind)
+{
+    switch (kind) {
+    case CommandKind::Times:
+    case CommandKind::Divide:
+        return TokenClass::Operator;
+    case CommandKind::Symbol:
+        return TokenClass::Symbol;
+    default:
+        return TokenClass::Keyword;
+    }
+}
+
+constexpr TokenClass tokenizeChar(char c)
+{
+    if (c >= 'a' && c <= 'z') {
+        return TokenClass::Symbol;
+    }
+    if (c == '+' || c == '-' || c == '*' || c == '/') {
+        return TokenClass::Operator;
+    }
+    switch (c) {
+    case '{':
+        return TokenClass::LeftBrace;
+    case '(':
+        return TokenClass::LeftParenthesis;
+    case '}':
+        return TokenClass::RightBrace;
+    case ')':
+        return TokenClass::RightParenthesis;
+    default:
+        return TokenClass::UnknownClass;
+    }
+}
+
 class Lexer {
 public:
     int tokenize(const std::string &iString);
+    int tokenize(const char *input, size_t len);
     int tokenize(std::ifstream &iFile);
-    std::vector<std::pair<TokenClass, std::string> > getStream () {return _tokenStream;}
+    int tokenize(const std::string &iString, uint32_t begin, uint32_t end);
+    const std::vector<std::pair<TokenClass, std::string> > &getStream () {return _tokenStream;}
+    const std::vector<uint32_t> &getPositions () {return _tokenPos;}
+    Error getLexError () {return _lexError;}
+    void setQuiet(bool quiet) {_quiet = quiet;}
+    void pushEOS();
+    void push(TokenClass cls, std::string_view text, uint32_t pos);
+    void reset();
     void printTokens();
 private:
     uint32_t _pos {0};
     std::string _curToken {""};
-#define PAIR(x, y) (uint32_t(x) << 16 | uint32_t(y))
-#define PFIRST(x) ((uint32_t(x) >> 16) & 0x0000ffff)
-#define PSECOND(x) (uint32_t(x) & 0x0000ffff)
-    const std::unordered_map<uint32_t, uint32_t> _stateTrans {
-        {PAIR(State::Init, CharacterType::Digit), PAIR(State::Number, Action::AddToken)},
-        {PAIR(State::Init, CharacterType::Letter), PAIR(State::Letter, Action::PushThis)},
-        {PAIR(State::Init, CharacterType::EscapeChar), PAIR(State::Escape, Action::AddToken)},
-        {PAIR(State::Init, CharacterType::WhiteSpace), PAIR(State::Init, Action::DoNothing)},
-        {PAIR(State::Init, CharacterType::Operator), PAIR(State::Init, Action::PushThis)},
-        {PAIR(State::Init, CharacterType::Bracket), PAIR(State::Init, Action::PushThis)},
-
-        {PAIR(State::Number, CharacterType::Digit), PAIR(State::Number, Action::AddToken)},
-        {PAIR(State::Number, CharacterType::Letter), PAIR(State::Letter, Action::PushTokenAndThis)},
-        {PAIR(State::Number, CharacterType::EscapeChar), PAIR(State::Escape, Action::PushToken)},
-        {PAIR(State::Number, CharacterType::WhiteSpace), PAIR(State::Init, Action::PushToken)},
-        {PAIR(State::Number, CharacterType::Operator), PAIR(State::Init, Action::PushTokenAndThis)},
-        {PAIR(State::Number, CharacterType::Bracket), PAIR(State::Init, Action::PushTokenAndThis)},
-
-        {PAIR(State::Letter, CharacterType::Digit), PAIR(Error::DigitAfterLetter, Action::ErrorHandle)},
-        {PAIR(State::Letter, CharacterType::Letter), PAIR(State::Letter, Action::PushThis)},
-        {PAIR(State::Letter, CharacterType::EscapeChar), PAIR(State::Escape, Action::AddToken)},
-        {PAIR(State::Letter, CharacterType::WhiteSpace), PAIR(State::Init, Action::DoNothing)},
-        {PAIR(State::Letter, CharacterType::Operator), PAIR(State::Init, Action::PushThis)},
-        {PAIR(State::Letter, CharacterType::Bracket), PAIR(State::Init, Action::PushThis)},
-
-        {PAIR(State::Escape, CharacterType::Digit), PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle)},
-        {PAIR(State::Escape, CharacterType::Letter), PAIR(State::Symbol, Action::AddToken)},
-        {PAIR(State::Escape, CharacterType::EscapeChar), PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle)},
-        {PAIR(State::Escape, CharacterType::WhiteSpace), PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle)},
-        {PAIR(State::Escape, CharacterType::Operator), PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle)},
-        {PAIR(State::Escape, CharacterType::Bracket), PAIR(Error::IllegalCharAfterEscape, Action::ErrorHandle)},
-
-        {PAIR(State::Symbol, CharacterType::Digit), PAIR(Error::DigitAfterLetter, Action::ErrorHandle)},
-        {PAIR(State::Symbol, CharacterType::Letter), PAIR(State::Symbol, Action::AddToken)},
-        {PAIR(State::Symbol, CharacterType::EscapeChar), PAIR(State::Escape, Action::PushToken)},
-        {PAIR(State::Symbol, CharacterType::WhiteSpace), PAIR(State::Init, Action::PushToken)},
-        {PAIR(State::Symbol, CharacterType::Operator), PAIR(State::Init, Action::PushTokenAndThis)},
-        {PAIR(State::Symbol, CharacterType::Bracket), PAIR(State::Init, Action::PushTokenAndThis)},
-    };
-
-    const std::unordered_set<std::string> _keywordPool {
-        "\\frac",
-    };
-
-    const std::unordered_set<std::string> _symbolPool {
-        "\\alpha", "\\beta", "\\gamma", "\\delta", "\\epsilon", "\\zeta", "\\eta", "\\theta", "\\lota", "\\kappa",
-        "\\lambda", "\\mu", "\\nu", "\\xi", "\\omicron", "\\pi", "\\rho", "\\sigma", "\\tau", "\\upsilon", "\\phi",
-        "\\chi", "\\psi", "\\omega",
-    };  // 24
-
     std::vector<std::pair<TokenClass, std::string> > _tokenStream {};
+    std::vector<uint32_t> _tokenPos {};     // character offset of every token in _tokenStream
     std::vector<std::pair<std::string, uint32_t> > _badSymbol {};
+    Error _lexError {Error::Success};       // first error reported while reading, 0 if none
+    bool _quiet {false};
 
-    const CharacterType classifyChar(char c)
-    {
-        if (c >= '0' && c <= '9') {
-            return CharacterType::Digit;
-        }
-        if (c >= 'a' && c <= 'z') {
-            return CharacterType::Letter;
-        }
-        if (c == '\\') {
-            return CharacterType::EscapeChar;
-        }
-        if (c == ' ' || c == '\0' || c == '\t' || c == '\n') {
-            return CharacterType::WhiteSpace;
-        }
-        if (c == '+' || c == '-' || c == '*' || c == '/') {
-            return CharacterType::Operator;
-        }
-        if (c == '{' || c == '}' || c == '(' || c == ')') {
-            return CharacterType::Bracket;
-        }
-        return CharacterType::IllegalChar;
-    }
-
-    const TokenClass tokenizeChar(char c)
-    {
-        if (c >= 'a' && c <= 'z') {
-            return TokenClass::Symbol;
-        }
-        if (c == '+' || c == '-' || c == '*' || c == '/') {
-            return TokenClass::Operator;
-        }
-        switch (c) {
-        case '{':
-            return TokenClass::LeftBrace;
-        case '(':
-            return TokenClass::LeftParenthesis;
-        case '}':
-            return TokenClass::RightBrace;
-        case ')':
-            return TokenClass::RightParenthesis;
-        default:
-            return TokenClass::UnknownClass;
-        }
-    }
-
+    State scan(const char *input, uint32_t end, State curState);
     State readChar(char c, State curState);
     inline void pushToken(State curState);
     inline void pushThis(char c);
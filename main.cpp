@@ -1,24 +1,75 @@
 #include <iostream>
-#include <memory>
-#include "lexer.h"
-#include "parser.h"
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <cerrno>
+#include <cstdlib>
+#include "session.h"
+#include "server.h"
+#include "eval.h"
+#include "c_codegen.h"
+
+// a whole decimal number which fits into val, false (and val unchanged) for anything else
+template <typename T>
+static bool parseCount(const char *arg, T &val)
+{
+	if (arg == nullptr || *arg < '0' || *arg > '9') {
+		return false;
+	}
+	char *end = nullptr;
+	errno = 0;
+	unsigned long long res = strtoull(arg, &end, 10);
+	if (*end != '\0' || errno != 0 || res > std::numeric_limits<T>::max()) {
+		return false;
+	}
+	val = T(res);
+	return true;
+}
 
 int main(int argc, char **argv)
 {
 	int ret = -1;
 	bool debug = false;
+	bool serveMode = false;
+	bool loadgenMode = false;
+	bool equivMode = false;
+	bool exact = false;
+	bool equal = false;
+	bool queryMode = false;
+	bool spillMode = false;
+	size_t spillMB = 0;
 
-	Lexer lexer;
-	Parser parser;
-
-	std::vector<std::pair<TokenClass, std::string> > tokenStream;
-	std::unique_ptr<BaseAST> ast;
+	Session session;
 
 	std::string inputString;
 	std::string inputFile;
 	std::string outputFile;
+	std::string saveProgram;
+	std::string loadProgram;
+	std::string programData;
+	std::string saveTokens;
+	std::string loadTokens;
+	std::string saveResult;
+	std::string loadResult;
+	std::string binaryData;
+	MappedFile mappedFile;
+	std::string pointsFile;
+	std::string functionName;
+	std::string equivA;
+	std::string equivB;
+	Program program;
+	std::vector<std::string> substs;
+	std::string profileFile;
+	Profile profile;
+	Bindings bindings;
+	Query query;
 
 	std::ifstream iFile;
+	std::ofstream oFile;
+
+	Budget budget;
+	ServerOptions serverOptions;
+	LoadgenOptions loadgenOptions;
 
 	for (int i = 1; i < argc; ) {
 		if (std::string(argv[i]).compare("--help") == 0) {
@@ -40,46 +91,395 @@ int main(int argc, char **argv)
 			++i;
 			outputFile = argv[i];
 			++i;
+		} else if (std::string(argv[i]).compare("--save-program") == 0) {
+			++i;
+			saveProgram = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--load-program") == 0) {
+			++i;
+			loadProgram = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--save-tokens") == 0) {
+			++i;
+			saveTokens = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--load-tokens") == 0) {
+			++i;
+			loadTokens = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--save-result") == 0) {
+			++i;
+			saveResult = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--load-result") == 0) {
+			++i;
+			loadResult = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--eval-points") == 0) {
+			++i;
+			pointsFile = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--emit-c") == 0) {
+			++i;
+			functionName = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--order") == 0) {
+			++i;
+			if (std::string(argv[i]).compare("lex") == 0) {
+				session.setOrder(MonomialOrder::Lex);
+			} else if (std::string(argv[i]).compare("grlex") == 0) {
+				session.setOrder(MonomialOrder::GradedLex);
+			} else if (std::string(argv[i]).compare("input") == 0) {
+				session.setOrder(MonomialOrder::Input);
+			} else {
+				goto HELP;
+			}
+			++i;
+		} else if (std::string(argv[i]).compare("--profile") == 0) {
+			++i;
+			profileFile = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--lazy") == 0) {
+			session.setLazy(true);
+			++i;
+		} else if (std::string(argv[i]).compare("--subst") == 0) {
+			++i;
+			if (std::string(argv[i]).find('=') == std::string::npos) {
+				goto HELP;
+			}
+			substs.push_back(argv[i]);
+			++i;
+		} else if (std::string(argv[i]).compare("--domain") == 0) {
+			++i;
+			if (std::string(argv[i]).compare("int") == 0) {
+				session.setDomain(CoefficientDomain::Int);
+			} else if (std::string(argv[i]).compare("exact") == 0) {
+				session.setDomain(CoefficientDomain::Exact);
+			} else if (std::string(argv[i]).compare("mod") == 0) {
+				session.setDomain(CoefficientDomain::Modular);
+			} else if (std::string(argv[i]).compare("double") == 0) {
+				session.setDomain(CoefficientDomain::Double);
+			} else {
+				goto HELP;
+			}
+			++i;
+		} else if (std::string(argv[i]).compare("--query") == 0) {
+			++i;
+			if (query.parse(argv[i]) != Error::Success) {
+				goto HELP;
+			}
+			queryMode = true;
+			++i;
+		} else if (std::string(argv[i]).compare("--spill") == 0) {
+			++i;
+			if (!parseCount(argv[i], spillMB) || spillMB > SIZE_MAX >> 20) {
+				goto HELP;
+			}
+			session.setSpill(spillMB << 20);
+			spillMode = true;
+			++i;
+		} else if (std::string(argv[i]).compare("--equiv") == 0) {
+			equivMode = true;
+			++i;
+			equivA = argv[i];
+			++i;
+			equivB = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--exact") == 0) {
+			exact = true;
+			++i;
+		} else if (std::string(argv[i]).compare("--max-terms") == 0) {
+			++i;
+			if (!parseCount(argv[i], budget.maxTerms)) {
+				goto HELP;
+			}
+			++i;
+		} else if (std::string(argv[i]).compare("--max-bits") == 0) {
+			++i;
+			if (!parseCount(argv[i], budget.maxCoefficientBits)) {
+				goto HELP;
+			}
+			++i;
+		} else if (std::string(argv[i]).compare("--max-nodes") == 0) {
+			++i;
+			if (!parseCount(argv[i], budget.maxNodes)) {
+				goto HELP;
+			}
+			++i;
+		} else if (std::string(argv[i]).compare("--deadline") == 0) {
+			++i;
+			if (!parseCount(argv[i], budget.deadlineMs)) {
+				goto HELP;
+			}
+			++i;
+		} else if (std::string(argv[i]).compare("--serve") == 0) {
+			serveMode = true;
+			++i;
+		} else if (std::string(argv[i]).compare("--loadgen") == 0) {
+			loadgenMode = true;
+			++i;
+		} else if (std::string(argv[i]).compare("--socket") == 0) {
+			++i;
+			serverOptions.socketPath = argv[i];
+			loadgenOptions.socketPath = argv[i];
+			++i;
+		} else if (std::string(argv[i]).compare("--threads") == 0) {
+			++i;
+			if (!parseCount(argv[i], serverOptions.threads)) {
+				goto HELP;
+			}
+			loadgenOptions.threads = serverOptions.threads;
+			++i;
+		} else if (std::string(argv[i]).compare("--requests") == 0) {
+			++i;
+			if (!parseCount(argv[i], loadgenOptions.requests)) {
+				goto HELP;
+			}
+			++i;
+		} else if (std::string(argv[i]).compare("--concurrency") == 0) {
+			++i;
+			if (!parseCount(argv[i], loadgenOptions.concurrency)) {
+				goto HELP;
+			}
+			loadgenOptions.concurrency = std::max(1u, loadgenOptions.concurrency);
+			++i;
+		} else if (std::string(argv[i]).compare("--pool-stats") == 0) {
+			serverOptions.poolStats = true;
+			loadgenOptions.poolStats = true;
+			++i;
 		} else {
 			goto HELP;
 		}
 	}
+
+	session.setBudget(budget);
+	if (serveMode) {
+		serverOptions.budget = budget;
+		return serve(serverOptions);
+	}
+
+	for (const std::string &subst : substs) {
+		// name=value, the value is simplified once and used for every symbol it replaces
+		size_t eq = subst.find('=');
+		ret = bindings.bind(subst.substr(0, eq), subst.substr(eq + 1));
+		if (ret != Error::Success) {
+			printf("Error: %s in --subst %s\n", dumpError(Error(ret)).c_str(), subst.c_str());
+			return ret;
+		}
+	}
+	session.setBindings(&bindings);
+
+	if (equivMode) {
+		session.setQuiet(false);
+		ret = session.equivalent(equivA, equivB, equal, exact);
+		if (ret != Error::Success) {
+			printf("Error: %s\n", dumpError(Error(ret)).c_str());
+			return ret;
+		}
+		std::cout << (equal ? "equal" : "not equal") << std::endl;
+		return 0;
+	}
+
+	if (!loadProgram.empty()) {
+		// a compiled program skips lexing and parsing
+		iFile.open(loadProgram, std::ios::in | std::ios::binary);
+		programData.assign(std::istreambuf_iterator<char>(iFile), std::istreambuf_iterator<char>());
+		ret = program.deserialize(programData);
+		if (ret != Error::Success) {
+			printf("Error: %s\n", dumpError(Error(ret)).c_str());
+			goto HELP;
+		}
+		if (debug) {
+			program.dump();
+		}
+		if (spillMode) {
+			goto SPILL;
+		}
+		ret = queryMode ? session.query(program, query) : session.run(program);
+		if (ret != Error::Success) {
+			printf("Error: %s\n", dumpError(Error(ret)).c_str());
+			return ret;
+		}
+		goto OUTPUT;
+	}
+
+	if (!loadResult.empty()) {
+		// a stored result skips every step
+		ret = mappedFile.open(loadResult);
+		if (ret == Error::Success) {
+			ret = session.loadResult(mappedFile.data(), mappedFile.size());
+		}
+		if (ret == Error::Success && queryMode) {
+			ret = session.answer(query);
+		}
+		if (ret != Error::Success) {
+			printf("Error: %s\n", dumpError(Error(ret)).c_str());
+			return ret;
+		}
+		goto OUTPUT;
+	}
 	
 	if (!inputFile.empty()) {
 		iFile.open(inputFile, std::ios::in);
-		ret = lexer.tokenize(iFile);
-	} else if (!inputString.empty()) {
-		ret = lexer.tokenize(inputString);
-	} else {
+		inputString.assign(std::istreambuf_iterator<char>(iFile), std::istreambuf_iterator<char>());
+	} else if (inputString.empty() && loadTokens.empty()) {
 		goto HELP;
 	}
+
+	if (loadgenMode) {
+		loadgenOptions.exe = argv[0];
+		loadgenOptions.expression = inputString;
+		return loadgen(loadgenOptions);
+	}
+
+	// the cli reports every error on its way, the library is quiet
+	session.setQuiet(false);
+	if (!loadTokens.empty()) {
+		// a stored token stream skips lexing
+		ret = mappedFile.open(loadTokens);
+		if (ret == Error::Success) {
+			ret = session.loadTokens(mappedFile.data(), mappedFile.size());
+		}
+	} else {
+		ret = session.tokenize(inputString.data(), inputString.size());
+	}
 	if (ret != Error::Success) {
 		printf("Error: %s\n", dumpError(Error(ret)).c_str());
 		goto HELP;
 	}
+	if (!saveTokens.empty()) {
+		session.storeTokens(binaryData);
+		oFile.open(saveTokens, std::ios::out | std::ios::binary);
+		oFile << binaryData;
+		oFile.close();
+	}
 	
 	if (debug) {
-		lexer.printTokens();
+		session.lexer().printTokens();
 	}
-	tokenStream = lexer.getStream();
-	tokenStream.push_back(std::make_pair(TokenClass::EOS, "$"));
 
-	ast = parser.parse(tokenStream);
-	if (parser.getSuccess()) {
+	ret = session.parse();
+	if (ret == Error::Success) {
 		if (debug) {
-			ast->Dump("% ");
+			session.ast()->Dump("% ");
 		}
-	} else {
+	} else if (ret == Error::SyntaxError) {
+		// the parser has printed every syntax error, nothing of the partial tree is evaluated
+		size_t count = session.parseErrors().size();
+		printf("Error: %s (%zu error%s)\n", dumpError(Error(ret)).c_str(), count, count == 1 ? "" : "s");
 		goto HELP;
+	} else {
+		printf("Error: %s\n", dumpError(Error(ret)).c_str());
+		return ret;
 	}
 
-	ast->calc();
-	BaseAST::resultExp.ExpSort();
-	std::cout << "$ ";
-	BaseAST::resultExp.CodeGen();
-	std::cout << " $" << std::endl;
+	if (spillMode) {
+		goto SPILL;
+	}
+	if (!profileFile.empty()) {
+		// also written if a budget stopped the evaluation, it shows where the time went
+		ret = session.profile(profile);
+		oFile.open(profileFile, std::ios::out);
+		if (profileFile.size() >= 5 && profileFile.compare(profileFile.size() - 5, 5, ".json") == 0) {
+			profile.writeChromeTrace(oFile);
+		} else {
+			profile.writeFolded(oFile);
+		}
+		oFile.close();
+	} else if (queryMode) {
+		ret = session.query(query);
+	} else {
+		ret = session.calc();
+	}
+	if (ret != Error::Success) {
+		printf("Error: %s\n", dumpError(Error(ret)).c_str());
+		return ret;
+	}
+	if (!saveProgram.empty()) {
+		session.compile(program);
+		if (debug) {
+			program.dump();
+		}
+		oFile.open(saveProgram, std::ios::out | std::ios::binary);
+		oFile << program.serialize();
+		oFile.close();
+	}
+
+OUTPUT:
+	if (queryMode) {
+		// the answer alone, neither the expression nor anything made from it
+		if (!outputFile.empty()) {
+			oFile.open(outputFile, std::ios::out);
+			oFile << session.output() << std::endl;
+		} else {
+			std::cout << session.output() << std::endl;
+		}
+		return 0;
+	}
+	if (!saveResult.empty()) {
+		binaryData.clear();
+		session.storeResult(binaryData);
+		oFile.open(saveResult, std::ios::out | std::ios::binary);
+		oFile << binaryData;
+		oFile.close();
+	}
+	if (!pointsFile.empty()) {
+		// the values at the points instead of the expression
+		iFile.close();
+		iFile.open(pointsFile, std::ios::in);
+		if (!outputFile.empty()) {
+			oFile.open(outputFile, std::ios::out);
+			ret = evalPoints(session.result(), iFile, oFile);
+		} else {
+			ret = evalPoints(session.result(), iFile, std::cout);
+		}
+		if (ret != Error::Success) {
+			printf("Error: %s\n", dumpError(Error(ret)).c_str());
+		}
+		return ret;
+	}
+	if (!functionName.empty()) {
+		// a c function evaluating the result instead of the expression
+		if (!outputFile.empty()) {
+			oFile.open(outputFile, std::ios::out);
+			ret = emitC(session.result(), functionName, oFile);
+		} else {
+			ret = emitC(session.result(), functionName, std::cout);
+		}
+		if (ret != Error::Success) {
+			printf("Error: %s\n", dumpError(Error(ret)).c_str());
+		}
+		return ret;
+	}
+	if (!outputFile.empty()) {
+		oFile.open(outputFile, std::ios::out);
+		oFile << "$ " << session.output() << " $" << std::endl;
+	} else {
+		std::cout << "$ " << session.output() << " $" << std::endl;
+	}
 	return 0;
 
+SPILL:
+	{
+		// the terms are written while the runs are merged, the result never is in memory
+		if (!outputFile.empty()) {
+			oFile.open(outputFile, std::ios::out);
+		}
+		std::ostream &os = outputFile.empty() ? std::cout : oFile;
+		os << "$ ";
+		ret = loadProgram.empty() ? session.spill(os) : session.spill(program, os);
+		os << " $" << std::endl;
+		if (debug) {
+			const SpillStats &stats = session.spillStats();
+			std::cout << "% " << stats.terms << " terms, " << stats.spilledTerms << " spilled in " << stats.runs <<
+				" runs, " << stats.spilledBytes << " bytes" << std::endl;
+		}
+		if (ret != Error::Success) {
+			printf("Error: %s\n", dumpError(Error(ret)).c_str());
+		}
+		return ret;
+	}
+
 HELP:
 	std::cout << "Usage: ./main [options]\n" <<
 		   		 "Options:\n" <<
@@ -88,6 +488,34 @@ HELP:
 			 	 "  -s <string>            Take the <string> as input LaTeX expression.\n" <<
 				 "  -f <file>              Take content in the <file> as input.\n" <<
 				 "  -o <file>              Place the output into <file>.\n" <<
+				 "  --save-program <file>  Save the compiled program of the input into <file>.\n" <<
+				 "  --load-program <file>  Run a program saved by --save-program instead of an input.\n" <<
+				 "  --save-tokens <file>   Save the token stream of the input into <file>, see binary_format.h.\n" <<
+				 "  --load-tokens <file>   Parse a token stream saved by --save-tokens instead of an input.\n" <<
+				 "  --save-result <file>   Save the simplified result into <file>.\n" <<
+				 "  --load-result <file>   Output a result saved by --save-result instead of an input.\n" <<
+				 "  --eval-points <file>   Output the values of the result at the points in <file>, see eval.h.\n" <<
+				 "  --emit-c <name>        Output a C function <name> evaluating the result, see c_codegen.h.\n" <<
+				 "  --order <order>        Order of the output terms: lex (default), grlex or input.\n" <<
+				 "  --profile <file>       Save the time and terms of every AST node, as a Chrome trace if <file> ends in .json, see profiler.h.\n" <<
+				 "  --lazy                 Keep products factored until the end of the evaluation, see lazy_exp.h.\n" <<
+				 "  --subst <name>=<expr>  Evaluate with the LaTeX <expr> in place of the symbol <name>, see substitution.h.\n" <<
+				 "  --domain <domain>      Coefficients: int (default), exact, mod (modulo 2^62-57) or double, see domain_exp.h.\n" <<
+				 "  --query <query>        Output only count (terms), degree or coeff:<monomial> (its coefficient) of the result, see query.h.\n" <<
+				 "  --spill <MB>           Keep at most <MB> megabytes of result terms in memory, the rest goes to sorted runs on disk, see spill.h.\n" <<
+				 "  --equiv <A> <B>        Check whether the expressions A and B are equal, see equiv.h.\n" <<
+				 "  --exact                Let --equiv compare the simplified expressions instead.\n" <<
+				 "  --max-terms <n>        Fail if an intermediate result has more than <n> terms, see budget.h.\n" <<
+				 "  --max-bits <n>         Fail if a numerator or denominator needs more than <n> bits.\n" <<
+				 "  --max-nodes <n>        Fail if the AST has more than <n> nodes.\n" <<
+				 "  --deadline <ms>        Fail if the evaluation takes longer than <ms> milliseconds.\n" <<
+				 "  --serve                Serve length-prefixed requests on stdin, see server.h.\n" <<
+				 "  --socket <path>        Serve on / connect to the unix domain socket <path> instead.\n" <<
+				 "  --threads <n>          Number of server worker threads, default one per cpu.\n" <<
+				 "  --loadgen              Send the input to a server repeatedly, report latency and throughput.\n" <<
+				 "  --requests <n>         Number of requests sent by --loadgen, default 100000.\n" <<
+				 "  --concurrency <n>      Requests in flight for --loadgen, default 64.\n" <<
+				 "  --pool-stats           Let every server worker report its term buffer allocations on exit, see buffer_pool.h.\n" <<
 				 "Option -f has higher priority than -s\n" <<
 				 "Append '> <file>' after all option to redirect the output into a file\n";
 	return 0;
@@ -0,0 +1,257 @@
+#ifndef PLT_MONOMIAL_H
+#define PLT_MONOMIAL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+/* Set of symbol ids (see symbol_table.h) making up a monomial, e.g. {a, b, x_{3}} for abx_{3}.
+ *
+ * The ids below DenseSymbols are bits of Words machine words, the rare ids above them are
+ * kept in a sorted vector on the heap, which does not exist as long as there are none. With
+ * Words = 1 a monomial of the first 64 symbols is a single word, compared and hashed as such.
+ *
+ * The order is the one of the bit patterns read as one big number, i.e. the monomial with
+ * the highest symbol the other one does not have is the larger one. For the first 64
+ * symbols it is the order of the uint64_t the monomials used to be.
+ */
+template <size_t Words>
+class MonomialKey {
+public:
+    static constexpr uint32_t DenseSymbols = 64 * Words;
+
+    MonomialKey() {};
+
+    MonomialKey(const MonomialKey &other) {
+        std::copy(other._dense, other._dense + Words, _dense);
+        if (other._sparse) {
+            _sparse.reset(new std::vector<uint32_t>(*other._sparse));
+        }
+    }
+
+    MonomialKey(MonomialKey &&other) noexcept = default;
+
+    MonomialKey &operator=(const MonomialKey &other) {
+        if (this != &other) {
+            std::copy(other._dense, other._dense + Words, _dense);
+            if (!other._sparse) {
+                _sparse.reset();
+            } else if (_sparse) {
+                *_sparse = *other._sparse;
+            } else {
+                _sparse.reset(new std::vector<uint32_t>(*other._sparse));
+            }
+        }
+        return *this;
+    }
+
+    MonomialKey &operator=(MonomialKey &&other) noexcept = default;
+
+    static MonomialKey symbol(uint32_t id) {
+        MonomialKey key;
+        key.insert(id);
+        return key;
+    }
+
+    bool empty() const {
+        for (size_t i = 0; i < Words; ++i) {
+            if (_dense[i] != 0) {
+                return false;
+            }
+        }
+        return !_sparse;
+    }
+
+    bool contains(uint32_t id) const {
+        if (id < DenseSymbols) {
+            return (_dense[id / 64] >> (id % 64)) & 1;
+        }
+        return _sparse && std::binary_search(_sparse->begin(), _sparse->end(), id);
+    }
+
+    void insert(uint32_t id) {
+        if (id < DenseSymbols) {
+            _dense[id / 64] |= 1ULL << (id % 64);
+            return;
+        }
+        if (!_sparse) {
+            _sparse.reset(new std::vector<uint32_t>());
+        }
+        auto it = std::lower_bound(_sparse->begin(), _sparse->end(), id);
+        if (it == _sparse->end() || *it != id) {
+            _sparse->insert(it, id);
+        }
+    }
+
+    void erase(uint32_t id) {
+        if (id < DenseSymbols) {
+            _dense[id / 64] &= ~(1ULL << (id % 64));
+            return;
+        }
+        if (_sparse) {
+            auto it = std::lower_bound(_sparse->begin(), _sparse->end(), id);
+            if (it != _sparse->end() && *it == id) {
+                _sparse->erase(it);
+            }
+            if (_sparse->empty()) {
+                _sparse.reset();
+            }
+        }
+    }
+
+    // the number of symbols
+    uint32_t degree() const {
+        uint32_t deg = _sparse ? _sparse->size() : 0;
+        for (size_t i = 0; i < Words; ++i) {
+            deg += __builtin_popcountll(_dense[i]);
+        }
+        return deg;
+    }
+
+    bool isDense() const {return !_sparse;}
+    uint64_t word(size_t i) const {return _dense[i];}
+    void setWord(size_t i, uint64_t word) {_dense[i] = word;}     // the ids i*64 .. i*64+63
+
+    // the highest id, the monomial must not be empty
+    uint32_t last() const {
+        if (_sparse) {
+            return _sparse->back();
+        }
+        size_t i = Words - 1;
+        while (_dense[i] == 0) {
+            --i;
+        }
+        return i * 64 + 63 - __builtin_clzll(_dense[i]);
+    }
+
+    // calls fn(id) for every id, in increasing order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t i = 0; i < Words; ++i) {
+            for (uint64_t rest = _dense[i]; rest != 0; rest &= rest - 1) {
+                fn(uint32_t(i * 64 + __builtin_ctzll(rest)));
+            }
+        }
+        if (_sparse) {
+            for (uint32_t id : *_sparse) {
+                fn(id);
+            }
+        }
+    }
+
+    bool disjoint(const MonomialKey &other) const {
+        for (size_t i = 0; i < Words; ++i) {
+            if (_dense[i] & other._dense[i]) {
+                return false;
+            }
+        }
+        if (!_sparse || !other._sparse) {
+            return true;
+        }
+        std::vector<uint32_t>::const_iterator a = _sparse->begin(), b = other._sparse->begin();
+        while (a != _sparse->end() && b != other._sparse->end()) {
+            if (*a == *b) {
+                return false;
+            }
+            *a < *b ? ++a : ++b;
+        }
+        return true;
+    }
+
+    // every symbol is one of other, e.g. ab of abc
+    bool subsetOf(const MonomialKey &other) const {
+        for (size_t i = 0; i < Words; ++i) {
+            if (_dense[i] & ~other._dense[i]) {
+                return false;
+            }
+        }
+        if (!_sparse) {
+            return true;
+        }
+        return other._sparse && std::includes(other._sparse->begin(), other._sparse->end(), _sparse->begin(), _sparse->end());
+    }
+
+    friend MonomialKey operator|(const MonomialKey &keyA, const MonomialKey &keyB) {
+        MonomialKey res;
+        for (size_t i = 0; i < Words; ++i) {
+            res._dense[i] = keyA._dense[i] | keyB._dense[i];
+        }
+        if (keyA._sparse || keyB._sparse) {
+            res._sparse.reset(new std::vector<uint32_t>());
+            static const std::vector<uint32_t> none;
+            const std::vector<uint32_t> &a = keyA._sparse ? *keyA._sparse : none;
+            const std::vector<uint32_t> &b = keyB._sparse ? *keyB._sparse : none;
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(*res._sparse));
+        }
+        return res;
+    }
+
+    friend bool operator==(const MonomialKey &keyA, const MonomialKey &keyB) {
+        for (size_t i = 0; i < Words; ++i) {
+            if (keyA._dense[i] != keyB._dense[i]) {
+                return false;
+            }
+        }
+        if (!keyA._sparse || !keyB._sparse) {
+            return !keyA._sparse && !keyB._sparse;
+        }
+        return *keyA._sparse == *keyB._sparse;
+    }
+
+    friend bool operator!=(const MonomialKey &keyA, const MonomialKey &keyB) {
+        return !(keyA == keyB);
+    }
+
+    friend bool operator<(const MonomialKey &keyA, const MonomialKey &keyB) {
+        if (keyA._sparse || keyB._sparse) {
+            // compare the highest ids first
+            static const std::vector<uint32_t> none;
+            const std::vector<uint32_t> &a = keyA._sparse ? *keyA._sparse : none;
+            const std::vector<uint32_t> &b = keyB._sparse ? *keyB._sparse : none;
+            std::vector<uint32_t>::const_reverse_iterator ia = a.rbegin(), ib = b.rbegin();
+            for ( ; ia != a.rend() && ib != b.rend(); ++ia, ++ib) {
+                if (*ia != *ib) {
+                    return *ia < *ib;
+                }
+            }
+            if (ia != a.rend() || ib != b.rend()) {
+                return ib != b.rend();
+            }
+        }
+        for (size_t i = Words; i-- > 0; ) {
+            if (keyA._dense[i] != keyB._dense[i]) {
+                return keyA._dense[i] < keyB._dense[i];
+            }
+        }
+        return false;
+    }
+
+    size_t hash() const {
+        uint64_t h = _dense[0];
+        for (size_t i = 1; i < Words; ++i) {
+            h = h * 0x9e3779b97f4a7c15ULL ^ _dense[i];
+        }
+        if (_sparse) {
+            for (uint32_t id : *_sparse) {
+                h = h * 0x9e3779b97f4a7c15ULL ^ id;
+            }
+        }
+        return h ^ (h >> 29);
+    }
+
+private:
+    uint64_t _dense[Words] {};
+    std::unique_ptr<std::vector<uint32_t> > _sparse;    // sorted ids >= DenseSymbols, null if there is none
+};
+
+template <size_t Words>
+struct MonomialHash {
+    size_t operator()(const MonomialKey<Words> &key) const {return key.hash();}
+};
+
+// the first 64 symbols (a-z, the greek letters and 14 more) fit in one word
+typedef MonomialKey<1> Monomial;
+
+#endif
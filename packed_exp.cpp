@@ -0,0 +1,160 @@
+#include "packed_exp.h"
+#include "budget.h"
+
+static void putVarint(uint64_t v, std::string &out)
+{
+    while (v >= 0x80) {
+        out.push_back(char(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(char(v));
+}
+
+static uint64_t getVarint(const uint8_t *&p)
+{
+    uint64_t v = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t byte = *p++;
+        v |= uint64_t(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return v;
+        }
+    }
+}
+
+// small negative numbers small as well
+static uint64_t zigzag(int64_t v) {return (uint64_t(v) << 1) ^ uint64_t(v >> 63);}
+static int64_t unzigzag(uint64_t v) {return int64_t(v >> 1) ^ -int64_t(v & 1);}
+
+bool monomialBefore(const Monomial &monoA, const Monomial &monoB, MonomialOrder order)
+{
+    if (order == MonomialOrder::GradedLex) {
+        uint32_t degA = monoA.degree(), degB = monoB.degree();
+        if (degA != degB) {
+            return degA < degB;
+        }
+    }
+    return monoA < monoB;
+}
+
+void PackedEncoder::put(const BasicTerm &term, std::string &out)
+{
+    const Monomial &mono = term.monomial;
+    uint32_t sparseCount = 0;
+    if (!mono.isDense()) {
+        sparseCount = mono.degree() - __builtin_popcountll(mono.word(0));
+    }
+    bool hasDenom = term.rational.denom != 1;
+    putVarint(uint64_t(sparseCount) << 1 | hasDenom, out);
+    putVarint(zigzag(int64_t(mono.word(0) - _word)), out);
+    _word = mono.word(0);
+    putVarint(zigzag(term.rational.numer), out);
+    if (hasDenom) {
+        putVarint(zigzag(term.rational.denom), out);
+    }
+    if (sparseCount > 0) {
+        uint32_t prev = Monomial::DenseSymbols - 1;
+        mono.forEach([&out, &prev](uint32_t id) {
+            if (id >= Monomial::DenseSymbols) {
+                putVarint(id - prev - 1, out);
+                prev = id;
+            }
+        });
+    }
+}
+
+void PackedDecoder::next(BasicTerm &term)
+{
+    uint64_t tag = getVarint(_p);
+    _word += uint64_t(unzigzag(getVarint(_p)));
+    term.rational.numer = int(unzigzag(getVarint(_p)));
+    term.rational.denom = tag & 1 ? int(unzigzag(getVarint(_p))) : 1;
+    term.monomial = Monomial();
+    term.monomial.setWord(0, _word);
+    uint32_t id = Monomial::DenseSymbols - 1;
+    for (uint64_t i = tag >> 1; i > 0; --i) {
+        id += uint32_t(getVarint(_p)) + 1;
+        term.monomial.insert(id);
+    }
+}
+
+void PackedExp::clear()
+{
+    _data.clear();
+    _blocks.clear();
+    _size = 0;
+}
+
+void PackedExp::push_back(const BasicTerm &term)
+{
+    if (_blocks.empty() || _blocks.back().count == BlockTerms) {
+        _blocks.push_back(Block{_data.size(), 0});
+        _encoder.start();
+    }
+    _encoder.put(term, _data);
+    _blocks.back().count++;
+    _size++;
+}
+
+void PackedExp::pack(const BasicExp &exp)
+{
+    clear();
+    for (const BasicTerm &term : exp.numer) {
+        push_back(term);
+    }
+}
+
+void PackedExp::unpack(BasicExp &exp) const
+{
+    exp.numer.clear();
+    exp.numer.reserve(_size);
+    Cursor cursor(*this);
+    BasicTerm term(Rational(0, 1), Monomial());
+    while (cursor.next(term)) {
+        exp.numer.push_back(std::move(term));
+    }
+}
+
+void PackedExp::CodeGen(std::ostream &os) const
+{
+    Cursor cursor(*this);
+    BasicTerm term(Rational(0, 1), Monomial());
+    for (bool first = true; cursor.next(term); first = false) {
+        if (!first && term.rational.positive()) {
+            os << "+";
+        }
+        term.CodeGen(os);
+    }
+}
+
+void PackedExp::merge(const PackedExp &expA, const PackedExp &expB, bool subtract, MonomialOrder order,
+                      PackedExp &res)
+{
+    checkDeadline(expA.size() + expB.size());
+    res.clear();
+    res._data.reserve(expA._data.size() + expB._data.size());
+    Cursor cursorA(expA), cursorB(expB);
+    BasicTerm termA(Rational(0, 1), Monomial()), termB(Rational(0, 1), Monomial());
+    bool haveA = cursorA.next(termA), haveB = cursorB.next(termB);
+    while (haveA && haveB) {
+        if (termA.monomial == termB.monomial) {
+            termA.rational = subtract ? termA.rational - termB.rational : termA.rational + termB.rational;
+            res.push_back(termA);
+            haveA = cursorA.next(termA);
+            haveB = cursorB.next(termB);
+        } else if (monomialBefore(termA.monomial, termB.monomial, order)) {
+            res.push_back(termA);
+            haveA = cursorA.next(termA);
+        } else {
+            res.push_back(subtract ? -termB : termB);
+            haveB = cursorB.next(termB);
+        }
+    }
+    for ( ; haveA; haveA = cursorA.next(termA)) {
+        res.push_back(termA);
+    }
+    for ( ; haveB; haveB = cursorB.next(termB)) {
+        res.push_back(subtract ? -termB : termB);
+    }
+    checkTerms(res.size());
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef PLT_PACKED_EXP_H
+#define PLT_PACKED_EXP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "basic_exp.h"
+
+/* Sorted results in a compressed form, for keeping and merging results of millions of terms.
+ *
+ * A BasicTerm takes 24 bytes, plus the heap vector of a monomial with ids above 63 and the
+ * spare capacity of the vector it is in. PackedExp keeps the terms in blocks of BlockTerms,
+ * every term as a few varints:
+ *   tag         number of sparse ids << 1, | 1 if the denominator is not 1
+ *   word        zigzag of the difference to the dense word of the term before in the block
+ *   numer       zigzag
+ *   denom       zigzag, only if the tag says so
+ *   sparse ids  the first one - DenseSymbols, then each difference - 1
+ * Next to each other in a sorted result the monomials share most of their bits, so the
+ * difference takes a byte or two, and most coefficients are small: a term takes 3-6 bytes.
+ * A block starts from the word 0 and is decoded on its own. The terms are only decoded one
+ * at a time, by PackedExp::Cursor, and merge() adds two packed results in one pass over both
+ * into a third one, so none of them is ever unpacked as a whole. The runs of spill.h are
+ * written in the same blocks.
+ */
+
+// the order of ExpSort(), Input has none and is taken as Lex
+bool monomialBefore(const Monomial &monoA, const Monomial &monoB, MonomialOrder order);
+
+// appends the terms of one block to a string
+class PackedEncoder {
+public:
+    void start() {_word = 0;}
+    void put(const BasicTerm &term, std::string &out);
+
+private:
+    uint64_t _word {0};
+};
+
+// reads the terms of one block, the caller knows how many there are
+class PackedDecoder {
+public:
+    void start(const char *data) {_p = reinterpret_cast<const uint8_t*>(data); _word = 0;}
+    void next(BasicTerm &term);
+    const char *position() const {return reinterpret_cast<const char*>(_p);}
+
+private:
+    const uint8_t *_p {nullptr};
+    uint64_t _word {0};
+};
+
+class PackedExp {
+public:
+    static constexpr uint32_t BlockTerms = 128;
+
+    class Cursor;
+
+    void clear();
+    void push_back(const BasicTerm &term);
+    void pack(const BasicExp &exp);             // the terms in their order, merge() needs them sorted
+    void unpack(BasicExp &exp) const;
+    void shrink() {_data.shrink_to_fit(); _blocks.shrink_to_fit();}
+
+    size_t size() const {return _size;}
+    size_t bytes() const {return _data.capacity() + _blocks.capacity() * sizeof(Block);}   // of memory
+    void CodeGen(std::ostream &os = std::cout) const;
+
+    // expA + expB (or expA - expB) into res, both sorted in order, like terms combined as by
+    // the BasicExp operators, the sum is sorted as well
+    static void merge(const PackedExp &expA, const PackedExp &expB, bool subtract, MonomialOrder order,
+                      PackedExp &res);
+
+private:
+    struct Block {
+        size_t offset;      // in _data
+        uint32_t count;
+    };
+
+    std::string _data;
+    std::vector<Block> _blocks;
+    size_t _size {0};
+    PackedEncoder _encoder;
+};
+
+class PackedExp::Cursor {
+public:
+    explicit Cursor(const PackedExp &exp) : _exp(exp) {};
+
+    // the next term into term, false after the last one
+    bool next(BasicTerm &term) {
+        if (_left == 0) {
+            if (_block == _exp._blocks.size()) {
+                return false;
+            }
+            _decoder.start(&_exp._data[_exp._blocks[_block].offset]);
+            _left = _exp._blocks[_block++].count;
+        }
+        _decoder.next(term);
+        _left--;
+        return true;
+    }
+
+private:
+    const PackedExp &_exp;
+    size_t _block {0};
+    uint32_t _left {0};
+    PackedDecoder _decoder;
+};
+
+#endif
\ No newline at end of file
@@ -1,172 +1,370 @@
 #include "parser.h"
 #include "error.h"
 
-BasicExp BaseAST::resultExp = BasicExp();
+thread_local BasicExp BaseAST::resultExp = BasicExp();
+thread_local bool BaseAST::memoize = false;
 
-std::unique_ptr<BaseAST> Parser::parse(std::vector<std::pair<TokenClass, std::string> > stream)
+static uint32_t tokenKind(const std::pair<TokenClass, std::string> &token)
 {
-    this->_stream = stream;
+    switch (token.first) {
+    case TokenClass::Symbol:
+        return KindSymbol;
+    case TokenClass::Number:
+        return KindNumber;
+    case TokenClass::Keyword:
+    case TokenClass::Operator:
+        if (token.second == "+") {
+            return KindPlus;
+        } else if (token.second == "-") {
+            return KindMinus;
+        } else if (token.second == "*") {
+            return KindTimes;
+        } else if (token.second == "/") {
+            return KindDivide;
+        } else if (const Command *cmd = findCommand(token.second)) {
+            static const uint32_t kinds[] = {KindFrac, KindTimes, KindDivide, KindLeft, KindRight, KindSymbol};
+            return kinds[uint32_t(cmd->kind)];
+        }
+        return 0;
+    case TokenClass::LeftParenthesis:
+        return KindLeftParenthesis;
+    case TokenClass::RightParenthesis:
+        return KindRightParenthesis;
+    case TokenClass::LeftBrace:
+        return KindLeftBrace;
+    case TokenClass::RightBrace:
+        return KindRightBrace;
+    case TokenClass::EOS:
+        return KindEOS;
+    default:
+        return 0;
+    }
+}
+
+// e.g. "symbol, number or \frac"
+static std::string kindsToString(uint32_t kinds)
+{
+    static const char *names[] = {
+        "symbol", "number", "\"\\frac\"", "\"+\"", "\"-\"", "\"*\"", "\"/\"", "\"(\"", "\")\"", "\"{\"", "\"}\"",
+        "end of input", "\"\\left\"", "\"\\right\"",
+    };
+    // "(" and ")" already say it, \left and \right are only named if nothing else would be
+    if (kinds & ~(KindLeft | KindRight)) {
+        kinds &= ~(KindLeft | KindRight);
+    }
+    std::string res;
+    int count = __builtin_popcount(kinds);
+    for (int i = 0, n = 0; i < 14; ++i) {
+        if (kinds & (1u << i)) {
+            if (n > 0) {
+                res += n == count - 1 ? " or " : ", ";
+            }
+            res += names[i];
+            ++n;
+        }
+    }
+    return res;
+}
+
+// every syntax error is reported, positions gives the character offsets of the tokens for them
+std::unique_ptr<BaseAST> Parser::parse(const std::vector<std::pair<TokenClass, std::string> > &stream,
+                                       const std::vector<uint32_t> *positions)
+{
+    reset();
+    _stream = &stream;
+    _positions = positions;
+    std::unique_ptr<BaseAST> expr = parseExpr();
+
+    // a ")" or "}" without its opening bracket ends the Expr early, the rest is still checked
+    while (cur().first != TokenClass::EOS) {
+        unexpected(KindEOS);
+        _pos++;
+        while (!(tokenKind(cur()) & (FirstExpr | FollowExpr))) {
+            skip();
+        }
+        if (tokenKind(cur()) & FirstExpr) {
+            parseExpr();
+        }
+    }
+    return expr;
+}
+
+// parse the Expr starting at token begin, it ends in front of the first token that cannot
+// continue it (normally the closing ')' or '}' or EOS), which can be read by getPos()
+std::unique_ptr<ExprAST> Parser::parseSubExpr(const std::vector<std::pair<TokenClass, std::string> > &stream,
+                                              uint32_t begin)
+{
+    reset();
+    _stream = &stream;
+    _pos = begin;
     return parseExpr();
 }
 
+void Parser::reset()
+{
+    _stream = nullptr;
+    _positions = nullptr;
+    _pos = 0;
+    _success = true;
+    _errors.clear();
+}
+
+// report the current token as unexpected, once per token
+void Parser::unexpected(uint32_t expected)
+{
+    _success = false;
+    if (!_errors.empty() && _errors.back().token == _pos) {
+        return;
+    }
+    uint32_t index = std::min<size_t>(_pos, _stream->size() - 1);
+    ParseError err;
+    err.token = _pos;
+    err.position = _positions != nullptr && index < _positions->size() ? (*_positions)[index] : _pos;
+    err.text = cur().second;
+    err.expected = kindsToString(expected);
+    if (!_quiet) {
+        if (cur().first == TokenClass::EOS) {
+            printf("Syntax error at position %u: unexpected end of input, expected %s\n",
+                   err.position, err.expected.c_str());
+        } else {
+            printf("Syntax error at position %u: unexpected \"%s\", expected %s\n",
+                   err.position, err.text.c_str(), err.expected.c_str());
+        }
+    }
+    _errors.push_back(std::move(err));
+}
+
+// panic mode: if the current token can neither start X nor (for a nullable X) follow it,
+// report it and skip tokens until one can start or follow X.
+// Returns whether X is to be parsed, otherwise the caller goes on without it.
+bool Parser::sync(uint32_t first, uint32_t follow, bool nullable)
+{
+    uint32_t accept = nullable ? first | follow : first;
+    if (tokenKind(cur()) & accept) {
+        return true;
+    }
+    unexpected(accept);
+    while (!(tokenKind(cur()) & (first | follow | KindEOS))) {
+        skip();
+    }
+    return tokenKind(cur()) & accept;
+}
+
+// skip the current token, a "(" or "{" together with everything up to its closing bracket,
+// so that the closing bracket is not reported once more
+void Parser::skip()
+{
+    uint32_t depth = 0;
+    do {
+        uint32_t kind = tokenKind(cur());
+        if (kind & KindEOS) {
+            return;
+        }
+        if (kind & (KindLeftParenthesis | KindLeftBrace)) {
+            depth++;
+        } else if ((kind & (KindRightParenthesis | KindRightBrace)) && depth > 0) {
+            depth--;
+        }
+        _pos++;
+    } while (depth > 0);
+}
+
+// a terminal required by the grammar, a missing one is reported and taken as inserted
+void Parser::expect(uint32_t kind)
+{
+    if (tokenKind(cur()) & kind) {
+        _pos++;
+    } else {
+        unexpected(kind);
+    }
+}
+
 std::unique_ptr<ExprAST> Parser::parseExpr()
 {
+    if (!sync(FirstExpr, FollowExpr, false)) {
+        return nullptr;
+    }
     std::unique_ptr<ExprAST> expr(new ExprAST());
-    switch (_stream[_pos].first) {
+    expr->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::Symbol:
     case TokenClass::Number:
     case TokenClass::Keyword:
     case TokenClass::LeftParenthesis:
         expr->term = parseTerm();
         expr->exprs = parseExprs();
+        expr->tokEnd = _pos;
         return expr;
     case TokenClass::Operator:
-        if (_stream[_pos].second == "+") {
+        if (cur().second == "+") {
             expr->term = parseTerm();
             expr->exprs = parseExprs();
+            expr->tokEnd = _pos;
             return expr;
-        } else if (_stream[_pos].second == "-") {
+        } else if (cur().second == "-") {
             expr->term = parseTerm();
             expr->exprs = parseExprs();
+            expr->tokEnd = _pos;
             return expr;
         } else {
             [[fallthrough]];
         }
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstExpr);
         return nullptr;
     }
 }
 
 std::unique_ptr<ExprsAST> Parser::parseExprs()
 {
+    if (!sync(FirstExprs, FollowExpr, true)) {
+        return nullptr;
+    }
     std::unique_ptr<ExprsAST> exprs(new ExprsAST());
-    switch (_stream[_pos].first) {
+    exprs->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::RightParenthesis:
     case TokenClass::RightBrace:
+    case TokenClass::Keyword:   // \right
     case TokenClass::EOS:
         exprs->type = -1;
+        exprs->tokEnd = _pos;
         return exprs;
     case TokenClass::Operator:
-        if (_stream[_pos].second == "+") {
+        if (cur().second == "+") {
             _pos++;
             exprs->type = 0;
             exprs->term = parseTerm();
             exprs->exprs = parseExprs();
+            exprs->tokEnd = _pos;
             return exprs;
-        } else if (_stream[_pos].second == "-") {
+        } else if (cur().second == "-") {
             _pos++;
             exprs->type = 1;
             exprs->term = parseTerm();
             exprs->exprs = parseExprs();
+            exprs->tokEnd = _pos;
             return exprs;
         } else {
             [[fallthrough]];
         }
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstExprs | FollowExpr);
         return nullptr;
     }
 }
 
 std::unique_ptr<TermAST> Parser::parseTerm()
 {
+    if (!sync(FirstExpr, FollowTerm, false)) {
+        return nullptr;
+    }
     std::unique_ptr<TermAST> term(new TermAST());
-    switch (_stream[_pos].first) {
+    term->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::Symbol:
     case TokenClass::Number:
     case TokenClass::Keyword:
     case TokenClass::LeftParenthesis:
         term->uExpr = parseUExpr();
         term->terms = parseTerms();
+        term->tokEnd = _pos;
         return term;
     case TokenClass::Operator:
-        if (_stream[_pos].second == "+") {
+        if (cur().second == "+") {
             term->uExpr = parseUExpr();
             term->terms = parseTerms();
+            term->tokEnd = _pos;
             return term;
-        } else if (_stream[_pos].second == "-") {
+        } else if (cur().second == "-") {
             term->uExpr = parseUExpr();
             term->terms = parseTerms();
+            term->tokEnd = _pos;
             return term;
         } else {
             [[fallthrough]];
         }
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstExpr);
         return nullptr;
     }
 }
 
 std::unique_ptr<TermsAST> Parser::parseTerms()
 {
+    if (!sync(FirstTerms, FollowTerm, true)) {
+        return nullptr;
+    }
     std::unique_ptr<TermsAST> terms(new TermsAST());
-    switch (_stream[_pos].first) {
+    terms->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::RightParenthesis:
     case TokenClass::RightBrace:
+    case TokenClass::Keyword:   // \right
     case TokenClass::EOS:
         terms->type = -1;
+        terms->tokEnd = _pos;
         return terms;
     case TokenClass::Operator:
-        if (_stream[_pos].second == "*") {
+        if (tokenKind(cur()) == KindTimes) {
             _pos++;
             terms->type = 0;
             terms->uExpr = parseUExpr();
             terms->terms = parseTerms();
+            terms->tokEnd = _pos;
             return terms;
-        } else if (_stream[_pos].second == "/") {
+        } else if (tokenKind(cur()) == KindDivide) {
             _pos++;
             terms->type = 1;
             terms->uExpr = parseUExpr();
             terms->terms = parseTerms();
+            terms->tokEnd = _pos;
             return terms;
         } else {
             terms->type = -1;
+            terms->tokEnd = _pos;
             return terms;
         }
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstTerms | FollowTerm);
         return nullptr;
     }
 }
 
 std::unique_ptr<UExprAST> Parser::parseUExpr()
 {
+    if (!sync(FirstExpr, FollowFact, false)) {
+        return nullptr;
+    }
     std::unique_ptr<UExprAST> uexpr(new UExprAST());
-    switch (_stream[_pos].first) {
+    uexpr->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::Symbol:
     case TokenClass::Number:
     case TokenClass::Keyword:
     case TokenClass::LeftParenthesis:
         uexpr->type = 2;
         uexpr->fact = parseFact();
+        uexpr->tokEnd = _pos;
         return uexpr;
     case TokenClass::Operator:
-        if (_stream[_pos].second == "+") {
+        if (cur().second == "+") {
             _pos++;
             uexpr->type = 0;
             uexpr->fact = parseFact();
+            uexpr->tokEnd = _pos;
             return uexpr;
-        } else if (_stream[_pos].second == "-") {
+        } else if (cur().second == "-") {
             _pos++;
             uexpr->type = 1;
             uexpr->fact = parseFact();
+            uexpr->tokEnd = _pos;
             return uexpr;
         } else {
             [[fallthrough]];
         }
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstExpr);
         return nullptr;
     }
 }
@@ -174,107 +372,140 @@ std::unique_ptr<UExprAST> Parser::parseUExpr()
 
 std::unique_ptr<FactAST> Parser::parseFact()
 {
+    if (!sync(FirstFact, FollowFact, false)) {
+        return nullptr;
+    }
     std::unique_ptr<FactAST> fact(new FactAST());
-    switch (_stream[_pos].first) {
+    fact->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::LeftParenthesis:
         _pos++;
         fact->type = 0;
         fact->expr = parseExpr();
-        _pos++;
+        expect(KindRightParenthesis);
+        fact->tokEnd = _pos;
         return fact;
-    case TokenClass::Number:
     case TokenClass::Keyword:
+        if (tokenKind(cur()) == KindLeft) {
+            _pos++;
+            expect(KindLeftParenthesis);
+            fact->type = 0;
+            fact->expr = parseExpr();
+            expect(KindRight);
+            expect(KindRightParenthesis);
+            fact->tokEnd = _pos;
+            return fact;
+        }
+        [[fallthrough]];
+    case TokenClass::Number:
         fact->type = 1;
         fact->num = parseNum();
         fact->symb0 = parseSymb0();
+        fact->tokEnd = _pos;
         return fact;
     case TokenClass::Symbol:
         fact->type = 2;
         fact->symbs = parseSymbs();
+        fact->tokEnd = _pos;
         return fact;
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstFact);
         return nullptr;
     }
 }
 
 std::unique_ptr<NumAST> Parser::parseNum()
 {
+    if (!sync(FirstNum, FollowNum, false)) {
+        return nullptr;
+    }
     std::unique_ptr<NumAST> num(new NumAST());
-    switch (_stream[_pos].first) {
+    num->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::Keyword:
         num->type = 0;
         num->frac = parseFrac();
+        num->tokEnd = _pos;
         return num;
     case TokenClass::Number:
         num->type = 1;
-        num->number = std::stoi(_stream[_pos].second);
+        num->number = std::stoi(cur().second);
         _pos++;
+        num->tokEnd = _pos;
         return num;
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstNum);
         return nullptr;
     }
 }
 
 std::unique_ptr<SymbsAST> Parser::parseSymbs()
 {
+    if (!sync(FirstSymbs, FollowFact, false)) {
+        return nullptr;
+    }
     std::unique_ptr<SymbsAST> symbs(new SymbsAST());
-    switch (_stream[_pos].first) {
+    symbs->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::Symbol:
-        symbs->symbol = _stream[_pos].second;
+        symbs->symbol = cur().second;
         _pos++;
         symbs->symb0 = parseSymb0();
+        symbs->tokEnd = _pos;
         return symbs;
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstSymbs);
         return nullptr;
     }
 }
 
 std::unique_ptr<Symb0AST> Parser::parseSymb0()
 {
+    if (!sync(FirstSymbs, FollowFact, true)) {
+        return nullptr;
+    }
     std::unique_ptr<Symb0AST> symb0(new Symb0AST());
-    switch (_stream[_pos].first) {
+    symb0->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::RightParenthesis:
     case TokenClass::RightBrace:
     case TokenClass::Operator:
+    case TokenClass::Keyword:   // \right
     case TokenClass::EOS:
         symb0->type = -1;
+        symb0->tokEnd = _pos;
         return symb0;
     case TokenClass::Symbol:
         symb0->type = 0;
         symb0->symbs = parseSymbs();
+        symb0->tokEnd = _pos;
         return symb0;
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstSymbs | FollowFact);
         return nullptr;
     }
 }
 
 std::unique_ptr<FracAST> Parser::parseFrac()
 {
+    if (!sync(FirstFrac, FollowNum, false)) {
+        return nullptr;
+    }
     std::unique_ptr<FracAST> frac(new FracAST());
-    switch (_stream[_pos].first) {
+    frac->tokBegin = _pos;
+    switch (cur().first) {
     case TokenClass::Keyword:
-        _pos += 2;
+        _pos++;
+        expect(KindLeftBrace);
         frac->expr_numer = parseExpr();
-        _pos += 2;
+        expect(KindRightBrace);
+        expect(KindLeftBrace);
         frac->expr_denom = parseExpr();
-        _pos++;
+        expect(KindRightBrace);
+        frac->tokEnd = _pos;
         return frac;
     default:
-        printf("Unexpected token \"%s\" at token %d\n", _stream[_pos].second.c_str(), _pos);
-        _pos++;
-        _success = false;
+        unexpected(FirstFrac);
         return nullptr;
     }
 }
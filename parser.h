@@ -2,6 +2,9 @@
 #define PLT_PARSER_H
 
 #include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
 #include "AST.h"
 #include "lexer.h"
 
@@ -12,12 +15,16 @@
  * Term  -> UExpr Terms
  * Terms -> ("*" | "/") UExpr Terms | e
  * UExpr -> ("+" | "-") Fact | Fact
- * Fact  -> "(" Expr ")" | Num Symb0 | Symbs
+ * Fact  -> "(" Expr ")" | "\left" "(" Expr "\right" ")" | Num Symb0 | Symbs
  * Num   -> Frac | number
  * Symbs -> symbol Symb0
  * Symb0 -> Symbs | e
  * Frac  -> "\frac" "{" Expr "}" "{" Expr "}"
- * 
+ *
+ * "\frac" stands for \dfrac and \tfrac as well, "*" for \cdot and \times and "/" for \div
+ * (see commands.h). "\left" is parsed like "(" and "\right" like ")", they are left out of
+ * the table.
+ *
  * Parsing table:
  *         Symbol        Number        "+" | "-"                "*" | "/"                 "\frac"                             "}"   "("            ")"   $
  * Expr  | Term Exprs  | Term Exprs  | Term Exprs             |                         | Term Exprs                        |     | Term Exprs   |     |   |
@@ -30,17 +37,86 @@
  * Symbs | Symb Symb0  |             |                        |                         |                                   |     |              |     |   |
  * Symb0 | Symbs       |             | e                      | e                       |                                   |  e  |              |  e  | e |
  * Frac  |             |             |                        |                         | "\frac" "{" Expr "}" "{" Expr "}" |     |              |     |   |
+ *
+ * FIRST and FOLLOW sets, a syntax error in X skips tokens until one of them (panic mode):
+ *         FIRST                           FOLLOW
+ * Expr  | symbol number \frac "(" "+" "-" | ")" "}" $
+ * Exprs | "+" "-" e                       | ")" "}" $
+ * Term  | symbol number \frac "(" "+" "-" | "+" "-" ")" "}" $
+ * Terms | "*" "/" e                       | "+" "-" ")" "}" $
+ * UExpr | symbol number \frac "(" "+" "-" | "*" "/" "+" "-" ")" "}" $
+ * Fact  | symbol number \frac "("         | "*" "/" "+" "-" ")" "}" $
+ * Num   | number \frac                    | symbol "*" "/" "+" "-" ")" "}" $
+ * Symbs | symbol                          | "*" "/" "+" "-" ")" "}" $
+ * Symb0 | symbol e                        | "*" "/" "+" "-" ")" "}" $
+ * Frac  | \frac                           | symbol "*" "/" "+" "-" ")" "}" $
  */
 
+// token kinds, bit masks so that a FIRST or FOLLOW set is a uint32_t
+enum TokenKind : uint32_t {
+    KindSymbol = 1 << 0,
+    KindNumber = 1 << 1,
+    KindFrac = 1 << 2,
+    KindPlus = 1 << 3,
+    KindMinus = 1 << 4,
+    KindTimes = 1 << 5,
+    KindDivide = 1 << 6,
+    KindLeftParenthesis = 1 << 7,
+    KindRightParenthesis = 1 << 8,
+    KindLeftBrace = 1 << 9,
+    KindRightBrace = 1 << 10,
+    KindEOS = 1 << 11,
+    KindLeft = 1 << 12,
+    KindRight = 1 << 13,
+};
+
+inline constexpr uint32_t FirstFact = KindSymbol | KindNumber | KindFrac | KindLeftParenthesis | KindLeft;
+inline constexpr uint32_t FirstExpr = FirstFact | KindPlus | KindMinus;     // = Term = UExpr
+inline constexpr uint32_t FirstExprs = KindPlus | KindMinus;
+inline constexpr uint32_t FirstTerms = KindTimes | KindDivide;
+inline constexpr uint32_t FirstNum = KindNumber | KindFrac;
+inline constexpr uint32_t FirstSymbs = KindSymbol;                         // = Symb0
+inline constexpr uint32_t FirstFrac = KindFrac;
+inline constexpr uint32_t FollowExpr = KindRightParenthesis | KindRightBrace | KindEOS | KindRight;  // = Exprs
+inline constexpr uint32_t FollowTerm = KindPlus | KindMinus | FollowExpr;               // = Terms
+inline constexpr uint32_t FollowFact = KindTimes | KindDivide | FollowTerm;             // = UExpr Symbs Symb0
+inline constexpr uint32_t FollowNum = KindSymbol | FollowFact;                          // = Frac
+
+struct ParseError {
+    uint32_t token;         // index in the token stream
+    uint32_t position;      // character offset of the token, the token index if not known
+    std::string text;       // the unexpected token, "$" is the end of input
+    std::string expected;
+};
+
 class Parser {
 public:
     bool getSuccess() {return _success;};
-    std::unique_ptr<BaseAST> parse(std::vector<std::pair<TokenClass, std::string> > stream);
+    uint32_t getPos() {return _pos;};
+    const std::vector<ParseError> &getErrors() {return _errors;};
+    void setQuiet(bool quiet) {_quiet = quiet;};
+    void reset();
+    std::unique_ptr<BaseAST> parse(const std::vector<std::pair<TokenClass, std::string> > &stream,
+                                   const std::vector<uint32_t> *positions = nullptr);
+    std::unique_ptr<ExprAST> parseSubExpr(const std::vector<std::pair<TokenClass, std::string> > &stream,
+                                          uint32_t begin);
 private:
     std::unique_ptr<BaseAST> _ast {nullptr};
-    std::vector<std::pair<TokenClass, std::string> > _stream;
+    const std::vector<std::pair<TokenClass, std::string> > *_stream {nullptr};
+    const std::vector<uint32_t> *_positions {nullptr};     // of the tokens, for the error messages
     uint32_t _pos {0};
     bool _success {true};
+    bool _quiet {false};
+    std::vector<ParseError> _errors {};
+
+    // the token at _pos, after an error _pos may run past the end so EOS is repeated
+    const std::pair<TokenClass, std::string> &cur() {
+        return (*_stream)[std::min<size_t>(_pos, _stream->size() - 1)];
+    }
+    void unexpected(uint32_t expected);
+    bool sync(uint32_t first, uint32_t follow, bool nullable);
+    void skip();
+    void expect(uint32_t kind);
     std::unique_ptr<ExprAST> parseExpr();
     std::unique_ptr<ExprsAST> parseExprs();
     std::unique_ptr<TermAST> parseTerm();
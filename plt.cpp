@@ -0,0 +1,93 @@
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "plt.h"
+#include "session.h"
+#include "error.h"
+
+struct plt_session {
+    Session session;
+};
+
+static int copyOut(const std::string &str, plt_buffer *out)
+{
+    if (out->data == nullptr || out->capacity < str.size() + 1) {
+        char *data = static_cast<char*>(realloc(out->data, str.size() + 1));
+        if (data == nullptr) {
+            return Error::OutOfMemory;
+        }
+        out->data = data;
+        out->capacity = str.size() + 1;
+    }
+    memcpy(out->data, str.data(), str.size());
+    out->data[str.size()] = '\0';
+    out->size = str.size();
+    return Error::Success;
+}
+
+// no exception may leave the C API
+static int simplify(Session &session, const char *input, size_t len, plt_buffer *out)
+{
+    int ret;
+    try {
+        ret = session.simplify(input, len);
+    } catch (const std::bad_alloc &) {
+        ret = Error::OutOfMemory;
+    } catch (const std::exception &) {
+        ret = Error::Unsupported;
+    }
+    if (ret != Error::Success) {
+        out->size = 0;
+        return ret;
+    }
+    return copyOut(session.output(), out);
+}
+
+extern "C" {
+
+int plt_simplify(const char *input, size_t len, plt_buffer *out)
+{
+    static thread_local Session session;
+    return simplify(session, input, len, out);
+}
+
+plt_session *plt_session_create(void)
+{
+    try {
+        return new plt_session();
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void plt_session_destroy(plt_session *session)
+{
+    delete session;
+}
+
+void plt_session_reset(plt_session *session)
+{
+    session->session.reset();
+}
+
+int plt_session_simplify(plt_session *session, const char *input, size_t len, plt_buffer *out)
+{
+    return simplify(session->session, input, len, out);
+}
+
+void plt_buffer_free(plt_buffer *buf)
+{
+    free(buf->data);
+    buf->data = nullptr;
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
+const char *plt_strerror(int err)
+{
+    static thread_local std::string msg;
+    msg = dumpError(Error(err));
+    return msg.c_str();
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef PLT_PLT_H
+#define PLT_PLT_H
+
+/* C API of libplt.
+ *
+ * All functions return 0 on success, otherwise one of the codes of error.h (the same ones
+ * the cli prints), plt_strerror() turns them into a message.
+ * Output is written to a plt_buffer which is grown with realloc() when needed, a buffer
+ * can be reused for many calls and has to be released with plt_buffer_free().
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLT_API_VERSION 1
+
+typedef struct plt_buffer {
+    char *data;         // NUL terminated
+    size_t size;        // without the NUL
+    size_t capacity;
+} plt_buffer;
+
+typedef struct plt_session plt_session;
+
+// simplify a LaTeX expression, e.g. "\frac{1}{2}a+\frac{1}{3}a" -> "\frac{5}{6}a"
+// uses a session owned by the calling thread
+int plt_simplify(const char *input, size_t len, plt_buffer *out);
+
+// explicit sessions, a session must not be used by two threads at the same time
+plt_session *plt_session_create(void);
+void plt_session_destroy(plt_session *session);
+void plt_session_reset(plt_session *session);
+int plt_session_simplify(plt_session *session, const char *input, size_t len, plt_buffer *out);
+
+void plt_buffer_free(plt_buffer *buf);
+const char *plt_strerror(int err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
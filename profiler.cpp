@@ -0,0 +1,161 @@
+#include <chrono>
+#include <cstdio>
+#include <typeinfo>
+#include "profiler.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static thread_local Clock::time_point profileStart;    // of the calc() of the root
+
+// stands in for a node while it is profiled
+class ProfileAST : public BaseAST {
+public:
+    std::unique_ptr<BaseAST> node;
+
+    ProfileAST(std::unique_ptr<BaseAST> &&wrapped, Profile &profile, uint32_t record)
+        : node(std::move(wrapped)), _profile(profile), _record(record) {
+        tokBegin = node->tokBegin;
+        tokEnd = node->tokEnd;
+    }
+
+    void Dump(std::string indent) const override{
+        node->Dump(indent);
+    }
+
+    // the record is also filled in if a budget stops the calc() of the node
+    void calc() const override{
+        Timer timer(*this);
+        node->calc();
+    }
+
+    void compile(Program &prog) const override{
+        node->compile(prog);
+    }
+
+    void forEachChild(const std::function<void(std::unique_ptr<BaseAST>&)> &fn) override{
+        node->forEachChild(fn);
+    }
+
+private:
+    Profile &_profile;
+    uint32_t _record;
+
+    struct Timer {
+        const ProfileAST &ast;
+        size_t allocations {heapAllocations};
+        Clock::time_point begin {Clock::now()};
+
+        explicit Timer(const ProfileAST &profiled) : ast(profiled) {};
+        ~Timer() {ast.record(begin, allocations);}
+    };
+
+    void record(Clock::time_point begin, size_t allocations) const {
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+        ProfileRecord &rec = _profile.records[_record];
+        rec.startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - profileStart).count();
+        rec.inclusiveNs = ns;
+        rec.exclusiveNs += ns;
+        rec.terms = resultExp.numer.size();
+        rec.allocations = heapAllocations - allocations;
+        if (rec.parent >= 0) {
+            _profile.records[rec.parent].exclusiveNs -= ns;
+        }
+    }
+};
+
+// the class name without the length gcc and clang put in front of it, "7FracAST" -> "FracAST"
+static std::string className(const BaseAST &node)
+{
+    const char *name = typeid(node).name();
+    while (*name >= '0' && *name <= '9') {
+        name++;
+    }
+    return name;
+}
+
+ProfileScope::ProfileScope(std::unique_ptr<BaseAST> &ast, Profile &profile) : _profile(profile)
+{
+    _profile.records.clear();
+    wrap(ast, -1);
+    profileStart = Clock::now();
+}
+
+// the nodes stay where they are, only the slots pointing to them are switched back
+ProfileScope::~ProfileScope()
+{
+    for (std::unique_ptr<BaseAST> *slot : _slots) {
+        *slot = std::move(static_cast<ProfileAST&>(**slot).node);
+    }
+}
+
+// empty nodes (the e of Exprs, Terms and Symb0) do nothing worth timing
+void ProfileScope::wrap(std::unique_ptr<BaseAST> &slot, int32_t parent)
+{
+    if (slot->tokBegin == slot->tokEnd) {
+        return;
+    }
+    uint32_t record = _profile.records.size();
+    _profile.records.emplace_back();
+    _profile.records.back().name = className(*slot);
+    _profile.records.back().parent = parent;
+    _profile.records.back().tokBegin = slot->tokBegin;
+    _profile.records.back().tokEnd = slot->tokEnd;
+    slot->forEachChild([this, record](std::unique_ptr<BaseAST> &child) {
+        wrap(child, record);
+    });
+    slot.reset(new ProfileAST(std::move(slot), _profile, record));
+    _slots.push_back(&slot);
+}
+
+void Profile::writeFolded(std::ostream &os) const
+{
+    std::vector<std::string> stacks(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        const ProfileRecord &rec = records[i];
+        if (rec.parent >= 0) {
+            stacks[i] = stacks[rec.parent] + ";";
+        }
+        stacks[i] += rec.name + "[" + std::to_string(rec.charBegin) + "," + std::to_string(rec.charEnd) + ")";
+        os << stacks[i] << " " << rec.exclusiveNs << "\n";
+    }
+}
+
+static void writeJsonString(std::ostream &os, const std::string &str)
+{
+    os << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            os << esc;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+// the timestamps and durations of the trace event format are in microseconds
+void Profile::writeChromeTrace(std::ostream &os) const
+{
+    char num[32];
+    os << "{\"traceEvents\":[";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const ProfileRecord &rec = records[i];
+        os << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(os, rec.name);
+        snprintf(num, sizeof(num), "%.3f", rec.startNs / 1000.0);
+        os << ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << num;
+        snprintf(num, sizeof(num), "%.3f", rec.inclusiveNs / 1000.0);
+        os << ",\"dur\":" << num << ",\"args\":{\"text\":";
+        writeJsonString(os, rec.text);
+        os << ",\"tokens\":\"" << rec.tokBegin << "-" << rec.tokEnd << "\""
+           << ",\"chars\":\"" << rec.charBegin << "-" << rec.charEnd << "\""
+           << ",\"self_ns\":" << rec.exclusiveNs
+           << ",\"terms\":" << rec.terms
+           << ",\"allocations\":" << rec.allocations << "}}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef PLT_PROFILER_H
+#define PLT_PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include "AST.h"
+
+/* Time, terms and allocations of every node of one calc(), see Session::profile().
+ *
+ * A ProfileScope wraps every node which covers at least one token in a ProfileAST for its
+ * lifetime. The wrapper reads the clock and the allocation counter of small_vector.h around
+ * the calc() of its node and fills in the node's record. Nothing is wrapped without
+ * profiling, so a plain calc() costs what it did before.
+ *
+ * A profile is written either as folded stacks, one line per node, for flamegraph.pl and
+ * speedscope:
+ *   ExprAST[0,27);TermAST[0,13);UExprAST[0,13);FactAST[0,13);NumAST[0,11);FracAST[0,11) 2140
+ * (the ranges are character positions in the input, the number is the exclusive time in ns),
+ * or as a Chrome trace (chrome://tracing, Perfetto), one complete event per node with the
+ * source text, the token and character range, the terms and the allocations as arguments.
+ */
+struct ProfileRecord {
+    std::string name;           // class of the node, e.g. "FracAST"
+    std::string text;           // its tokens, shortened to MaxText characters
+    int32_t parent {-1};        // index of the record of the enclosing node, -1 for the root
+    uint32_t tokBegin {0};      // [tokBegin, tokEnd) in the token stream
+    uint32_t tokEnd {0};
+    uint32_t charBegin {0};     // [charBegin, charEnd) in the input
+    uint32_t charEnd {0};
+    uint64_t startNs {0};       // since the start of the calc()
+    uint64_t inclusiveNs {0};
+    uint64_t exclusiveNs {0};   // without the time of the nodes below
+    size_t terms {0};           // of the BasicExp the node left in BaseAST::resultExp
+    size_t allocations {0};     // heap allocations of term vectors, including the nodes below
+};
+
+class Profile {
+public:
+    static constexpr size_t MaxText = 64;
+
+    std::vector<ProfileRecord> records;     // parents before their children
+
+    void writeFolded(std::ostream &os) const;
+    void writeChromeTrace(std::ostream &os) const;
+};
+
+class ProfileScope {
+public:
+    // the records get the names and token ranges of the nodes, Session fills in the rest
+    ProfileScope(std::unique_ptr<BaseAST> &ast, Profile &profile);
+    ~ProfileScope();
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    Profile &_profile;
+    std::vector<std::unique_ptr<BaseAST>*> _slots;     // the wrapped ones
+
+    void wrap(std::unique_ptr<BaseAST> &slot, int32_t parent);
+};
+
+#endif
\ No newline at end of file
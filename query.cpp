@@ -0,0 +1,77 @@
+#include "query.h"
+#include "lexer.h"
+#include "error.h"
+
+int Query::parse(const std::string &spec)
+{
+    static const std::string coeff("coeff:");
+    monomial = Monomial();
+    if (spec == "count") {
+        kind = QueryKind::Count;
+        return Error::Success;
+    }
+    if (spec == "degree") {
+        kind = QueryKind::Degree;
+        return Error::Success;
+    }
+    if (spec.compare(0, coeff.size(), coeff) != 0) {
+        return Error::BadQuery;
+    }
+    kind = QueryKind::Coefficient;
+    std::string mono = spec.substr(coeff.size());
+    if (mono == "1") {
+        return Error::Success;
+    }
+
+    // the symbols as the lexer splits them, each one at most once
+    Lexer lexer;
+    lexer.setQuiet(true);
+    if (mono.empty() || lexer.tokenize(mono.data(), mono.size()) != Error::Success) {
+        return Error::BadQuery;
+    }
+    for (const std::pair<TokenClass, std::string> &token : lexer.getStream()) {
+        if (token.first != TokenClass::Symbol) {
+            return Error::BadQuery;
+        }
+        uint32_t id = SymbolTable::global().intern(token.second);
+        if (monomial.contains(id)) {
+            return Error::BadQuery;
+        }
+        monomial.insert(id);
+    }
+    return Error::Success;
+}
+
+void Query::answer(const BasicExp &result, std::ostream &os) const
+{
+    if (kind == QueryKind::Count) {
+        size_t count = 0;
+        for (const BasicTerm &term : result.numer) {
+            count += term.rational.numer != 0;
+        }
+        os << count;
+        return;
+    }
+    if (kind == QueryKind::Degree) {
+        int degree = -1;
+        for (const BasicTerm &term : result.numer) {
+            if (term.rational.numer != 0) {
+                degree = std::max(degree, int(term.monomial.degree()));
+            }
+        }
+        os << degree;
+        return;
+    }
+
+    Rational coefficient(0, 1);
+    for (const BasicTerm &term : result.numer) {
+        if (term.monomial == monomial) {
+            coefficient = coefficient + term.rational;
+        }
+    }
+    if (coefficient.denom == 1) {
+        os << coefficient.numer;
+    } else {
+        coefficient.CodeGen(os);
+    }
+}
\ No newline at end of file
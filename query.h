@@ -0,0 +1,40 @@
+#ifndef PLT_QUERY_H
+#define PLT_QUERY_H
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include "basic_exp.h"
+
+/* Questions about the simplified result which need neither its order nor its output:
+ *   count          the number of terms
+ *   degree         the highest number of symbols of a term, -1 for 0
+ *   coeff:<mono>   the coefficient of the monomial <mono>, e.g. coeff:ab or coeff:x_{1}\alpha,
+ *                  coeff:1 is the constant term
+ * A term with the coefficient 0 (as of a-a) counts for none of them.
+ *
+ * The answer is read off the unsorted terms of the evaluation, ExpSort() and CodeGen() do
+ * not run. For a coefficient the evaluation is pruned as well: a term of a product is the
+ * union of one term of each factor and a sum or quotient keeps the monomials, so a term
+ * whose monomial is not a subset of the requested one never contributes to it. The
+ * Interpreter drops such terms where they are pushed (see bytecode.h), nothing built from
+ * them is expanded, e.g. the coefficient of abc in a product of 20 binomials needs at most
+ * 8 terms per intermediate result instead of up to 2^20.
+ */
+enum class QueryKind : uint32_t {
+    Count,
+    Degree,
+    Coefficient,
+};
+
+struct Query {
+    QueryKind kind {QueryKind::Count};
+    Monomial monomial;      // of Coefficient, empty for the constant term
+
+    // "count", "degree" or "coeff:<mono>", Error::BadQuery if it is none of them
+    int parse(const std::string &spec);
+    // the coefficient may throw BudgetExceeded, see budget.h
+    void answer(const BasicExp &result, std::ostream &os) const;
+};
+
+#endif
\ No newline at end of file
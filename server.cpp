@@ -0,0 +1,441 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "server.h"
+#include "session.h"
+#include "buffer_pool.h"
+#include "error.h"
+
+static const uint32_t MaxPayload = 64u << 20;   // a larger length means the stream is broken
+
+static bool readFull(int fd, void *buf, size_t len)
+{
+    char *p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool writeFull(int fd, const void *buf, size_t len)
+{
+    const char *p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void putU32(std::string &buf, uint32_t val)
+{
+    for (int i = 0; i < 4; ++i) {
+        buf.push_back(char(val >> (8 * i)));
+    }
+}
+
+// read a frame of n uint32 header fields, the last one is the length of the payload
+static bool readFrame(int fd, uint32_t *header, int n, std::string &payload)
+{
+    unsigned char raw[16];
+    if (!readFull(fd, raw, 4 * n)) {
+        return false;
+    }
+    for (int i = 0; i < n; ++i) {
+        header[i] = uint32_t(raw[4 * i]) | uint32_t(raw[4 * i + 1]) << 8 |
+                    uint32_t(raw[4 * i + 2]) << 16 | uint32_t(raw[4 * i + 3]) << 24;
+    }
+    uint32_t len = header[n - 1];
+    if (len > MaxPayload) {
+        return false;
+    }
+    payload.resize(len);
+    return len == 0 || readFull(fd, &payload[0], len);
+}
+
+// one client, the responses of several workers are serialised by writeMutex
+struct Connection {
+    int inFd;
+    int outFd;
+    bool ownsFd;
+    std::mutex writeMutex;
+    bool broken {false};
+
+    Connection(int in, int out, bool owns) : inFd(in), outFd(out), ownsFd(owns) {};
+    ~Connection() {
+        if (ownsFd) {
+            close(inFd);
+        }
+    }
+};
+
+struct Request {
+    std::shared_ptr<Connection> conn;
+    uint32_t id {0};
+    std::string payload;
+};
+
+// bounded, so a client which sends faster than we simplify gets blocked instead of
+// filling up the memory
+class RequestQueue {
+public:
+    RequestQueue(size_t capacity) : _capacity(capacity) {};
+
+    void push(Request &&req) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [&] {return _queue.size() < _capacity;});
+        _queue.push_back(std::move(req));
+        _notEmpty.notify_one();
+    }
+
+    // false once the queue is closed and drained
+    bool pop(Request &req) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [&] {return !_queue.empty() || _closed;});
+        if (_queue.empty()) {
+            return false;
+        }
+        req = std::move(_queue.front());
+        _queue.pop_front();
+        _notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _notEmpty.notify_all();
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+    std::deque<Request> _queue;
+    size_t _capacity;
+    bool _closed {false};
+};
+
+static void worker(RequestQueue &queue, const ServerOptions &options, uint32_t index)
+{
+    Session session;    // stays warm for every request of this thread
+    session.setBudget(options.budget);
+    ProgramCache cache(1024);
+    Request req;
+    std::string frame;
+    // the term buffer allocations (see buffer_pool.h) at the last two powers of two requests,
+    // the steady state is measured from the one at no more than half of them
+    size_t requests = 0;
+    size_t marks[2][2] = {{0, heapAllocations}, {0, heapAllocations}};
+
+    while (queue.pop(req)) {
+        int ret;
+        try {
+            ret = session.simplify(req.payload, cache);
+        } catch (const std::bad_alloc &) {
+            ret = Error::OutOfMemory;
+        } catch (...) {
+            ret = Error::Unsupported;   // a bad request only fails itself
+        }
+        std::string msg = ret == Error::Success ? std::string() : dumpError(Error(ret));
+        if (ret == Error::SyntaxError) {
+            for (const ParseError &err : session.parseErrors()) {
+                msg += "\nposition " + std::to_string(err.position) + ": unexpected \"" + err.text +
+                       "\", expected " + err.expected;
+            }
+        }
+        const std::string &body = ret == Error::Success ? session.output() : msg;
+
+        frame.clear();
+        putU32(frame, req.id);
+        putU32(frame, ret);
+        putU32(frame, body.size());
+        frame += body;
+        {
+            std::lock_guard<std::mutex> lock(req.conn->writeMutex);
+            if (!req.conn->broken && !writeFull(req.conn->outFd, frame.data(), frame.size())) {
+                req.conn->broken = true;
+            }
+        }
+        req.conn = nullptr;
+        requests++;
+        if ((requests & (requests - 1)) == 0) {
+            marks[0][0] = marks[1][0];
+            marks[0][1] = marks[1][1];
+            marks[1][0] = requests;
+            marks[1][1] = heapAllocations;
+        }
+    }
+
+    if (options.poolStats && requests > 0) {
+        const size_t *mark = marks[2 * marks[1][0] <= requests ? 1 : 0];
+        const BufferPool::Stats &stats = BufferPool::stats();
+        fprintf(stderr, "worker %u: %zu requests, pool hits %zu, misses %zu, %.3f allocations per request after %zu\n",
+                index, requests, stats.hits, stats.misses,
+                double(heapAllocations - mark[1]) / (requests - mark[0]), mark[0]);
+    }
+}
+
+static void readRequests(std::shared_ptr<Connection> conn, RequestQueue &queue)
+{
+    uint32_t header[2];
+    Request req;
+
+    while (readFrame(conn->inFd, header, 2, req.payload)) {
+        req.id = header[0];
+        req.conn = conn;
+        queue.push(std::move(req));
+        req = Request();
+    }
+}
+
+static int listenUnix(const std::string &path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path too long: %s\n", path.c_str());
+        return -1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+        perror(path.c_str());
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int connectUnix(const std::string &path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path too long: %s\n", path.c_str());
+        return -1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror(path.c_str());
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int serve(const ServerOptions &options)
+{
+    uint32_t threads = options.threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // a client going away must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = -1;
+    if (!options.socketPath.empty()) {
+        listenFd = listenUnix(options.socketPath);
+        if (listenFd < 0) {
+            return -1;
+        }
+    }
+
+    RequestQueue queue(threads * 64);
+    std::vector<std::thread> pool;
+    for (uint32_t i = 0; i < threads; ++i) {
+        pool.emplace_back(worker, std::ref(queue), std::cref(options), i);
+    }
+
+    if (listenFd < 0) {
+        readRequests(std::make_shared<Connection>(STDIN_FILENO, STDOUT_FILENO, false), queue);
+    } else {
+        // serves until the process is killed
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno != EINTR && errno != ECONNABORTED) {
+                    perror("accept");
+                }
+                continue;
+            }
+            std::thread(readRequests, std::make_shared<Connection>(fd, fd, true), std::ref(queue)).detach();
+        }
+    }
+
+    queue.close();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    return 0;
+}
+
+int loadgen(const LoadgenOptions &options)
+{
+    typedef std::chrono::steady_clock Clock;
+    int inFd = -1;
+    int outFd = -1;
+    pid_t child = -1;
+
+    if (!options.socketPath.empty()) {
+        inFd = outFd = connectUnix(options.socketPath);
+        if (inFd < 0) {
+            return -1;
+        }
+    } else {
+        int toServer[2];
+        int fromServer[2];
+        if (pipe(toServer) < 0 || pipe(fromServer) < 0) {
+            perror("pipe");
+            return -1;
+        }
+        child = fork();
+        if (child < 0) {
+            perror("fork");
+            return -1;
+        }
+        if (child == 0) {
+            dup2(toServer[0], STDIN_FILENO);
+            dup2(fromServer[1], STDOUT_FILENO);
+            close(toServer[0]);
+            close(toServer[1]);
+            close(fromServer[0]);
+            close(fromServer[1]);
+            std::string threads = std::to_string(options.threads);
+            execl(options.exe.c_str(), options.exe.c_str(), "--serve", "--threads", threads.c_str(),
+                  options.poolStats ? "--pool-stats" : nullptr, nullptr);
+            perror(options.exe.c_str());
+            _exit(127);
+        }
+        close(toServer[0]);
+        close(fromServer[1]);
+        outFd = toServer[1];
+        inFd = fromServer[0];
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    uint32_t total = options.requests;
+    std::vector<Clock::time_point> sent(total);
+    std::vector<double> latency;
+    latency.reserve(total);
+
+    std::mutex mutex;
+    std::condition_variable window;
+    uint32_t inflight = 0;
+    bool stop = false;
+
+    Clock::time_point start = Clock::now();
+    std::thread writer([&] {
+        std::string frame;
+        for (uint32_t id = 0; id < total; ++id) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                window.wait(lock, [&] {return inflight < options.concurrency || stop;});
+                if (stop) {
+                    return;
+                }
+                ++inflight;
+                sent[id] = Clock::now();
+            }
+            frame.clear();
+            putU32(frame, id);
+            putU32(frame, options.expression.size());
+            frame += options.expression;
+            if (!writeFull(outFd, frame.data(), frame.size())) {
+                return;
+            }
+        }
+    });
+
+    uint32_t header[3];
+    uint32_t errors = 0;
+    std::string payload;
+    std::string result;
+    for (uint32_t i = 0; i < total; ++i) {
+        if (!readFrame(inFd, header, 3, payload) || header[0] >= total) {
+            fprintf(stderr, "Error: server closed the connection after %u responses\n", i);
+            break;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        latency.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent[header[0]]).count());
+        --inflight;
+        window.notify_one();
+        if (header[1] != Error::Success) {
+            ++errors;
+        }
+        if (i == 0) {
+            result = payload;
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        window.notify_all();
+    }
+    writer.join();
+
+    if (child > 0) {
+        close(outFd);   // EOF lets the server drain and exit
+        close(inFd);
+        waitpid(child, nullptr, 0);
+    } else {
+        close(inFd);
+    }
+
+    if (latency.empty()) {
+        return -1;
+    }
+    std::sort(latency.begin(), latency.end());
+    size_t n = latency.size();
+    printf("result: %s\n", result.c_str());
+    printf("requests %zu, concurrency %u, errors %u\n", n, options.concurrency, errors);
+    printf("latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           latency[n / 2], latency[std::min(n - 1, n * 99 / 100)], latency[n - 1]);
+    printf("throughput %.0f requests/s\n", n / seconds);
+    return n == total ? 0 : -1;
+}
@@ -0,0 +1,42 @@
+#ifndef PLT_SERVER_H
+#define PLT_SERVER_H
+
+#include <cstdint>
+#include <string>
+#include "budget.h"
+
+/* Long running server mode.
+ *
+ * Every request and response is a frame of little-endian uint32 fields:
+ *   request:  id, length, <length bytes of LaTeX>
+ *   response: id, status, length, <length bytes>
+ * status is 0 or a code of error.h, the bytes are the simplified expression (without the
+ * "$ $" of the cli) or the error message. Requests are handed to a pool of worker threads,
+ * each of them owns a Session which stays warm between requests and a ProgramCache, so a
+ * text seen before is not lexed and parsed again. Responses are written as soon as they are
+ * ready, so they can come back in a different order than the requests. Every request is
+ * evaluated within the budget of the options, one which exceeds it gets the error code and
+ * costs the worker no more than the budget.
+ */
+
+struct ServerOptions {
+    std::string socketPath;     // empty: serve one client on stdin/stdout
+    uint32_t threads {0};       // 0: one per hardware thread
+    Budget budget;              // of every request
+    bool poolStats {false};     // every worker reports its term buffer allocations on exit
+};
+
+struct LoadgenOptions {
+    std::string socketPath;     // empty: spawn "<exe> --serve" and talk to it over pipes
+    std::string exe;            // the cli itself, used to spawn the server
+    std::string expression;
+    uint32_t threads {0};       // passed on to a spawned server
+    uint32_t requests {100000};
+    uint32_t concurrency {64};  // requests in flight
+    bool poolStats {false};     // passed on to a spawned server
+};
+
+int serve(const ServerOptions &options);
+int loadgen(const LoadgenOptions &options);
+
+#endif
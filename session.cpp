@@ -0,0 +1,407 @@
+#include <stdexcept>
+#include "session.h"
+#include "error.h"
+
+Session::Session()
+{
+    setQuiet(true);
+}
+
+// rewind every stage, nothing is freed except the previous AST
+void Session::reset()
+{
+    _lexer.reset();
+    _parser.reset();
+    _ast = nullptr;
+    _result.numer.clear();
+    _packedResult.clear();
+    _outBuf.str.clear();
+}
+
+void Session::setQuiet(bool quiet)
+{
+    _lexer.setQuiet(quiet);
+    _parser.setQuiet(quiet);
+}
+
+int Session::tokenize(const char *input, size_t len)
+{
+    reset();
+    return _lexer.tokenize(input, len);
+}
+
+static size_t countNodes(std::unique_ptr<BaseAST> &node)
+{
+    size_t count = 1;
+    node->forEachChild([&count](std::unique_ptr<BaseAST> &child) {
+        count += countNodes(child);
+    });
+    return count;
+}
+
+int Session::parse()
+{
+    _lexer.pushEOS();
+    try {
+        _ast = _parser.parse(_lexer.getStream(), &_lexer.getPositions());
+    } catch (const std::out_of_range &) {
+        _ast = nullptr;
+        return Error::NumberTooLarge;  // std::stoi in Parser::parseNum
+    }
+    if (!_parser.getSuccess()) {
+        _ast = nullptr;
+        return Error::SyntaxError;
+    }
+    if (_budget.maxNodes > 0 && countNodes(_ast) > _budget.maxNodes) {
+        _ast = nullptr;
+        return Error::TooManyNodes;
+    }
+    return Error::Success;
+}
+
+int Session::calc()
+{
+    if (_lazy || _domain != CoefficientDomain::Int) {
+        compile(_program);
+        return run(_program);
+    }
+    return calcTree();
+}
+
+int Session::calcTree()
+{
+    try {
+        BudgetScope scope(_budget);
+        BindingScope bindings(_bindings);
+        _ast->calc();
+    } catch (const BudgetExceeded &err) {
+        return err.error;
+    } catch (const UnsupportedOperation &) {
+        return Error::Unsupported;
+    }
+    output(BaseAST::resultExp);
+    return Error::Success;
+}
+
+int Session::profile(Profile &profile)
+{
+    int ret;
+    {
+        ProfileScope scope(_ast, profile);
+        ret = calcTree();
+    }
+    const std::vector<std::pair<TokenClass, std::string> > &stream = _lexer.getStream();
+    const std::vector<uint32_t> &positions = _lexer.getPositions();
+    for (ProfileRecord &rec : profile.records) {
+        rec.charBegin = positions[rec.tokBegin];
+        rec.charEnd = positions[rec.tokEnd - 1] + stream[rec.tokEnd - 1].second.size();
+        for (uint32_t tok = rec.tokBegin; tok < rec.tokEnd && rec.text.size() <= Profile::MaxText; ++tok) {
+            if (tok > rec.tokBegin && positions[tok] > positions[tok - 1] + stream[tok - 1].second.size()) {
+                rec.text += " ";
+            }
+            rec.text += stream[tok].second;
+        }
+        if (rec.text.size() > Profile::MaxText) {
+            rec.text.resize(Profile::MaxText - 3);
+            rec.text += "...";
+        }
+    }
+    return ret;
+}
+
+int Session::query(const Query &query)
+{
+    compile(_program);
+    return this->query(_program, query);
+}
+
+// the program must be verified, it runs in the int domain whatever setDomain() says
+int Session::query(const Program &prog, const Query &query)
+{
+    _result.numer.clear();
+    _packedResult.clear();
+    _outBuf.str.clear();
+    try {
+        BudgetScope scope(_budget);
+        BindingScope bindings(_bindings);
+        BasicExp result;
+        int ret = Error::Success;
+        if (query.kind == QueryKind::Coefficient) {
+            ret = _interpreter.run(prog, result, &query.monomial);
+        } else if (_lazy) {
+            _lazyExp.build(prog);
+            _lazyExp.expand(result);
+        } else {
+            ret = _interpreter.run(prog, result);
+        }
+        if (ret != Error::Success) {
+            return ret;
+        }
+        query.answer(result, _out);
+    } catch (const std::bad_alloc &) {
+        return Error::OutOfMemory;
+    } catch (const BudgetExceeded &err) {
+        return err.error;
+    } catch (const UnsupportedOperation &) {
+        return Error::Unsupported;
+    }
+    return Error::Success;
+}
+
+int Session::answer(const Query &query)
+{
+    _outBuf.str.clear();
+    try {
+        BudgetScope scope(_budget);
+        query.answer(_result, _out);
+    } catch (const BudgetExceeded &err) {
+        return err.error;
+    }
+    return Error::Success;
+}
+
+int Session::spill(std::ostream &os)
+{
+    compile(_program);
+    return spill(_program, os);
+}
+
+// the program must be verified, it runs in the int domain whatever setDomain() says
+int Session::spill(const Program &prog, std::ostream &os)
+{
+    _result.numer.clear();
+    _packedResult.clear();
+    _outBuf.str.clear();
+    _spillStats = SpillStats();
+    try {
+        BudgetScope scope(_budget);
+        BindingScope bindings(_bindings);
+        SpilledExp spilled(_spillBytes, _order);
+        _lazyExp.build(prog);
+        _lazyExp.stream(spilled, spilled.maxTerms());
+        spilled.write(os);
+        _spillStats = spilled.stats();
+    } catch (const std::bad_alloc &) {
+        return Error::OutOfMemory;
+    } catch (const BudgetExceeded &err) {
+        return err.error;
+    } catch (const UnsupportedOperation &) {
+        return Error::Unsupported;
+    } catch (const SpillError &) {
+        return Error::SpillFailed;
+    }
+    return Error::Success;
+}
+
+// take the result over from an evaluation, sorted and with its CodeGen in output()
+void Session::output(BasicExp &result)
+{
+    _result.numer.swap(result.numer);
+    _result.ExpSort(_order);
+    _outBuf.str.clear();
+    _result.CodeGen(_out);
+    _packedResult.clear();
+    if (_packed) {
+        _packedResult.pack(_result);
+        _packedResult.shrink();
+        BasicExp().numer.swap(_result.numer);   // frees it
+    }
+}
+
+void Session::compile(Program &prog) const
+{
+    prog.code.clear();
+    _ast->compile(prog);
+}
+
+// the program must be verified, see Program::verify()
+int Session::run(const Program &prog)
+{
+    try {
+        BudgetScope scope(_budget);
+        BindingScope bindings(_bindings);
+        if (_domain != CoefficientDomain::Int) {
+            _result.numer.clear();
+            _packedResult.clear();
+            _outBuf.str.clear();
+            return evaluate(prog, _domain, _order, _out);
+        }
+        BasicExp result;
+        if (_lazy) {
+            _lazyExp.build(prog);
+            _lazyExp.expand(result);
+        } else {
+            int ret = _interpreter.run(prog, result);
+            if (ret != Error::Success) {
+                return ret;
+            }
+        }
+        output(result);
+    } catch (const std::bad_alloc &) {
+        return Error::OutOfMemory;
+    } catch (const BudgetExceeded &err) {
+        return err.error;
+    } catch (const UnsupportedOperation &) {
+        return Error::Unsupported;
+    }
+    return Error::Success;
+}
+
+int Session::simplify(const std::string &text, ProgramCache &cache)
+{
+    const Program *prog = cache.find(text);
+    if (prog != nullptr) {
+        return run(*prog);
+    }
+    int ret = simplify(text.data(), text.size());
+    if (ret == Error::Success) {
+        try {
+            Program compiled;
+            compile(compiled);
+            cache.insert(text, std::move(compiled));
+        } catch (const std::bad_alloc &) {
+            // only the cache entry is missing
+        }
+    }
+    return ret;
+}
+
+// no exception leaves simplify(), the library and the server turn them into error codes
+int Session::simplify(const char *input, size_t len)
+{
+    try {
+        int ret = tokenize(input, len);
+        if (ret != Error::Success) {
+            return ret;
+        }
+        ret = parse();
+        if (ret != Error::Success) {
+            return ret;
+        }
+        ret = calc();
+        if (ret != Error::Success) {
+            return ret;
+        }
+    } catch (const std::bad_alloc &) {
+        return Error::OutOfMemory;
+    } catch (const std::exception &) {
+        return Error::Unsupported;     // anything else the input could trigger
+    }
+    return Error::Success;
+}
+
+// parse the text and compile it, nothing is evaluated
+int Session::compile(const std::string &text, Program &prog)
+{
+    int ret = tokenize(text.data(), text.size());
+    if (ret != Error::Success) {
+        return ret;
+    }
+    ret = parse();
+    if (ret != Error::Success) {
+        return ret;
+    }
+    compile(prog);
+    return Error::Success;
+}
+
+// the terms with a coefficient other than 0 are the same
+static bool sameTerms(const BasicExp &expA, const BasicExp &expB)
+{
+    const BasicTerm *termA = expA.numer.begin(), *termB = expB.numer.begin();
+    while (true) {
+        while (termA != expA.numer.end() && termA->rational.numer == 0) {
+            termA++;
+        }
+        while (termB != expB.numer.end() && termB->rational.numer == 0) {
+            termB++;
+        }
+        if (termA == expA.numer.end() || termB == expB.numer.end()) {
+            return termA == expA.numer.end() && termB == expB.numer.end();
+        }
+        if (termA->monomial != termB->monomial ||
+            int64_t(termA->rational.numer) * termB->rational.denom != int64_t(termB->rational.numer) * termA->rational.denom) {
+            return false;
+        }
+        termA++;
+        termB++;
+    }
+}
+
+int Session::equivalent(const std::string &textA, const std::string &textB, bool &equal, bool exact)
+{
+    try {
+        if (exact) {
+            // in the int domain and in Lex order, whatever setDomain(), setOrder() and setPacked() say
+            const std::string *texts[2] = {&textA, &textB};
+            BasicExp results[2];
+            for (int i = 0; i < 2; ++i) {
+                Program prog;
+                int ret = compile(*texts[i], prog);
+                if (ret == Error::Success) {
+                    BudgetScope scope(_budget);
+                    BindingScope bindings(_bindings);
+                    ret = _interpreter.run(prog, results[i]);
+                }
+                if (ret != Error::Success) {
+                    return ret;
+                }
+                results[i].ExpSort(MonomialOrder::Lex);
+            }
+            equal = sameTerms(results[0], results[1]);
+            return Error::Success;
+        }
+
+        Program progA, progB;
+        int ret = compile(textA, progA);
+        if (ret != Error::Success) {
+            return ret;
+        }
+        ret = compile(textB, progB);
+        if (ret != Error::Success) {
+            return ret;
+        }
+        BindingScope bindings(_bindings);
+        return ::equivalent(progA, progB, equal);
+    } catch (const std::bad_alloc &) {
+        return Error::OutOfMemory;
+    } catch (const BudgetExceeded &err) {
+        return err.error;
+    } catch (const std::exception &) {
+        return Error::Unsupported;
+    }
+}
+
+int Session::loadTokens(const char *data, size_t len)
+{
+    reset();
+    TokenView view;
+    int ret = view.open(data, len);
+    if (ret != Error::Success) {
+        return ret;
+    }
+    for (uint32_t i = 0; i < view.size(); ++i) {
+        _lexer.push(view.tokenClass(i), view.text(i), view.position(i));
+    }
+    return Error::Success;
+}
+
+int Session::loadResult(const char *data, size_t len)
+{
+    reset();
+    ResultView view;
+    BasicExp result;
+    int ret = view.open(data, len);
+    if (ret == Error::Success) {
+        ret = view.load(result);
+    }
+    if (ret == Error::Success) {
+        output(result);
+    }
+    return ret;
+}
+
+void Session::storeTokens(std::string &buf)
+{
+    ::storeTokens(_lexer.getStream(), _lexer.getPositions(), buf);
+}
\ No newline at end of file
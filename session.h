@@ -0,0 +1,136 @@
+#ifndef PLT_SESSION_H
+#define PLT_SESSION_H
+
+#include <memory>
+#include <streambuf>
+#include "AST.h"
+#include "lexer.h"
+#include "parser.h"
+#include "bytecode.h"
+#include "equiv.h"
+#include "binary_format.h"
+#include "budget.h"
+#include "substitution.h"
+#include "lazy_exp.h"
+#include "profiler.h"
+#include "domain_exp.h"
+#include "query.h"
+#include "packed_exp.h"
+
+// streambuf appending to a std::string, clearing the string keeps its capacity
+class StringBuf : public std::streambuf {
+public:
+    std::string str;
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            str.push_back(char(c));
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        str.append(s, n);
+        return n;
+    }
+};
+
+/* One lexer -> parser -> calc -> codegen pipeline which can be reused for any number of
+ * inputs. reset() is called at the start of every tokenize(), it only rewinds the state,
+ * the token stream and output buffers keep their capacity for the next input.
+ *
+ * simplify() runs all the steps, the single steps are there for callers which want to
+ * look at the intermediate results (e.g. --debug of the cli).
+ * compile() turns the parsed AST into a Program, run() evaluates one instead of calc(), the
+ * simplify() with a ProgramCache skips lexing and parsing for texts it has seen before.
+ * equivalent() compares two texts, by evaluating them at random points (see equiv.h) or, if
+ * exact, by simplifying both and comparing their terms in Lex order.
+ * loadTokens() and loadResult() take the place of tokenize() or of all the steps, with the
+ * token stream or result a storeTokens() or storeResult() wrote before (see binary_format.h).
+ * setBudget() limits the AST of parse() and the evaluation of calc() and run() (see budget.h),
+ * they return the error code of the first limit which is exceeded.
+ * setBindings() substitutes values for symbols in calc() and run() (see substitution.h), the
+ * AST of one parse() can be evaluated with any number of them. The bindings are not copied.
+ * setLazy() lets calc() and run() build a LazyExp of the program and expand it at the end
+ * instead of expanding every product right away (see lazy_exp.h), the result is the same.
+ * setDomain() lets calc() and run() evaluate the program over another coefficient domain (see
+ * domain_exp.h), only output() is set then, result() stays empty.
+ * profile() is a calc() which records the time, terms and allocations of every AST node
+ * (see profiler.h), it always walks the tree.
+ * query() is a calc() which only answers query (see query.h), the answer is put in output()
+ * and result() stays empty. The terms are not sorted, and for a coefficient only the ones
+ * which can reach its monomial are evaluated. answer() answers it from result() instead.
+ * spill() is a calc() for results larger than the memory: once more than setSpill() bytes
+ * of terms are collected they go to sorted runs on disk, and the CodeGen is written to os
+ * while the runs are merged (see spill.h), result() and output() stay empty.
+ * setPacked() keeps the sorted result as a PackedExp (see packed_exp.h) of a few bytes per
+ * term instead, in packedResult(), result() is freed after the CodeGen and stays empty.
+ * The lexer and parser are quiet by default, the errors are only returned.
+ */
+class Session {
+public:
+    Session();
+    void reset();
+    void setQuiet(bool quiet);
+    void setOrder(MonomialOrder order) {_order = order;}    // of the terms in result()
+    void setBudget(const Budget &budget) {_budget = budget;}
+    void setBindings(const Bindings *bindings) {_bindings = bindings;}   // null for none
+    void setLazy(bool lazy) {_lazy = lazy;}
+    void setDomain(CoefficientDomain domain) {_domain = domain;}
+    void setSpill(size_t maxBytes) {_spillBytes = maxBytes;}
+    void setPacked(bool packed) {_packed = packed;}
+
+    int tokenize(const char *input, size_t len);
+    int parse();
+    int calc();
+    int profile(Profile &profile);
+    int query(const Query &query);
+    int query(const Program &prog, const Query &query);
+    int answer(const Query &query);
+    int spill(std::ostream &os);
+    int spill(const Program &prog, std::ostream &os);
+    int simplify(const char *input, size_t len);
+    void compile(Program &prog) const;
+    int run(const Program &prog);
+    int simplify(const std::string &text, ProgramCache &cache);
+    int equivalent(const std::string &textA, const std::string &textB, bool &equal, bool exact = false);
+    int loadTokens(const char *data, size_t len);
+    int loadResult(const char *data, size_t len);
+    void storeTokens(std::string &buf);
+    void storeResult(std::string &buf) const {::storeResult(_result, buf);}
+
+    Lexer &lexer() {return _lexer;}
+    const BaseAST *ast() const {return _ast.get();}
+    const std::vector<ParseError> &parseErrors() {return _parser.getErrors();}  // all of them, after parse()
+    const BasicExp &result() const {return _result;}
+    const std::string &output() const {return _outBuf.str;}    // CodeGen of result()
+    const SpillStats &spillStats() const {return _spillStats;}  // of the last spill()
+    const PackedExp &packedResult() const {return _packedResult;}   // with setPacked()
+
+private:
+    Lexer _lexer;
+    Parser _parser;
+    std::unique_ptr<BaseAST> _ast {nullptr};
+    BasicExp _result;
+    StringBuf _outBuf;
+    std::ostream _out {&_outBuf};
+    Interpreter _interpreter;
+    LazyExp _lazyExp;
+    Program _program;   // of calc() if it is lazy
+    bool _lazy {false};
+    CoefficientDomain _domain {CoefficientDomain::Int};
+    MonomialOrder _order {MonomialOrder::Lex};
+    size_t _spillBytes {size_t(256) << 20};
+    SpillStats _spillStats;
+    bool _packed {false};
+    PackedExp _packedResult;
+    Budget _budget;
+    const Bindings *_bindings {nullptr};
+
+    void output(BasicExp &result);
+    int calcTree();
+    int compile(const std::string &text, Program &prog);
+};
+
+#endif
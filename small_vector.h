@@ -0,0 +1,197 @@
+#ifndef PLT_SMALL_VECTOR_H
+#define PLT_SMALL_VECTOR_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <algorithm>
+
+// heap buffers allocated by the SmallVectors of this thread, see profiler.h
+inline thread_local size_t heapAllocations = 0;
+
+struct HeapBuffers {
+    static void *allocate(size_t &bytes) {
+        heapAllocations++;
+        return ::operator new(bytes);
+    }
+
+    static void deallocate(void *buf, size_t) {
+        ::operator delete(buf);
+    }
+};
+
+/* std::vector-like container which keeps up to N elements inside the object itself and
+ * only goes to the heap when it grows beyond that. clear() keeps the capacity, a heap
+ * buffer is reused until the vector is destroyed or moved from.
+ * Moving a vector with a heap buffer steals the buffer, moving an inline one moves its
+ * elements one by one.
+ *
+ * The heap buffers come from Alloc, which has static allocate(size_t &bytes) returning
+ * at least bytes (and setting bytes to what it returned) and deallocate(buf, bytes), see
+ * buffer_pool.h.
+ */
+template <typename T, size_t N, typename Alloc = HeapBuffers>
+class SmallVector {
+public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    SmallVector() {};
+
+    SmallVector(const SmallVector &other) {
+        reserve(other._size);
+        for (const T &val : other) {
+            new (_data + _size) T(val);
+            ++_size;
+        }
+    }
+
+    SmallVector(SmallVector &&other) noexcept {
+        moveFrom(other);
+    }
+
+    ~SmallVector() {
+        clear();
+        freeHeap();
+    }
+
+    SmallVector &operator=(const SmallVector &other) {
+        if (this != &other) {
+            clear();
+            reserve(other._size);
+            for (const T &val : other) {
+                new (_data + _size) T(val);
+                ++_size;
+            }
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other) noexcept {
+        if (this != &other) {
+            clear();
+            freeHeap();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    size_t size() const {return _size;}
+    bool empty() const {return _size == 0;}
+    size_t capacity() const {return _capacity;}
+    bool isInline() const {return _data == inlineData();}
+
+    T *data() {return _data;}
+    const T *data() const {return _data;}
+    iterator begin() {return _data;}
+    iterator end() {return _data + _size;}
+    const_iterator begin() const {return _data;}
+    const_iterator end() const {return _data + _size;}
+    T &operator[](size_t i) {return _data[i];}
+    const T &operator[](size_t i) const {return _data[i];}
+    T &front() {return _data[0];}
+    const T &front() const {return _data[0];}
+    T &back() {return _data[_size - 1];}
+    const T &back() const {return _data[_size - 1];}
+
+    void push_back(const T &val) {
+        emplace_back(val);
+    }
+
+    void push_back(T &&val) {
+        emplace_back(std::move(val));
+    }
+
+    template <typename... Args>
+    T &emplace_back(Args &&... args) {
+        if (_size == _capacity) {
+            // the arguments may point into the old buffer
+            T val(std::forward<Args>(args)...);
+            grow(_size + 1);
+            new (_data + _size) T(std::move(val));
+        } else {
+            new (_data + _size) T(std::forward<Args>(args)...);
+        }
+        return _data[_size++];
+    }
+
+    void pop_back() {
+        _data[--_size].~T();
+    }
+
+    void clear() {
+        for (size_t i = 0; i < _size; ++i) {
+            _data[i].~T();
+        }
+        _size = 0;
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity > _capacity) {
+            grow(capacity);
+        }
+    }
+
+    void swap(SmallVector &other) {
+        if (!isInline() && !other.isInline()) {
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+            std::swap(_capacity, other._capacity);
+            return;
+        }
+        SmallVector tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+private:
+    T *_data {inlineData()};
+    size_t _size {0};
+    size_t _capacity {N};
+    alignas(T) unsigned char _inline[N * sizeof(T)];
+
+    T *inlineData() {return reinterpret_cast<T*>(_inline);}
+    const T *inlineData() const {return reinterpret_cast<const T*>(_inline);}
+
+    void grow(size_t capacity) {
+        size_t bytes = std::max(capacity, 2 * _capacity) * sizeof(T);
+        T *data = static_cast<T*>(Alloc::allocate(bytes));
+        capacity = bytes / sizeof(T);
+        for (size_t i = 0; i < _size; ++i) {
+            new (data + i) T(std::move(_data[i]));
+            _data[i].~T();
+        }
+        freeHeap();
+        _data = data;
+        _capacity = capacity;
+    }
+
+    void freeHeap() {
+        if (!isInline()) {
+            Alloc::deallocate(_data, _capacity * sizeof(T));
+            _data = inlineData();
+            _capacity = N;
+        }
+    }
+
+    // this is empty and inline
+    void moveFrom(SmallVector &other) {
+        if (other.isInline()) {
+            for (size_t i = 0; i < other._size; ++i) {
+                new (_data + i) T(std::move(other._data[i]));
+            }
+            _size = other._size;
+            other.clear();
+        } else {
+            _data = other._data;
+            _size = other._size;
+            _capacity = other._capacity;
+            other._data = other.inlineData();
+            other._size = 0;
+            other._capacity = N;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include "spill.h"
+#include "packed_exp.h"
+#include "budget.h"
+
+// the terms of one run, read in blocks of ReadBuffer bytes
+class SpilledExp::Reader {
+public:
+    BasicTerm term {Rational(0, 1), Monomial()};
+
+    Reader(int fd, const Run &run) : _fd(fd), _pos(run.begin), _end(run.end) {};
+
+    // the next term of the run into term, false at its end
+    bool next() {
+        if (_left == 0) {
+            if (_at == _len && _pos == _end) {
+                return false;
+            }
+            uint32_t header[2];     // bytes, terms
+            memcpy(header, ensure(sizeof(header)), sizeof(header));
+            const char *block = ensure(sizeof(header) + header[0]);
+            _decoder.start(block + sizeof(header));
+            _at += sizeof(header) + header[0];     // stays in the buffer until the next block
+            _left = header[1];
+        }
+        _decoder.next(term);
+        _left--;
+        return true;
+    }
+
+private:
+    int _fd;
+    uint64_t _pos;          // in the file, of the bytes after the buffer
+    uint64_t _end;
+    std::vector<char> _buf;
+    size_t _at {0};         // next unread byte of the buffer
+    size_t _len {0};
+    PackedDecoder _decoder;
+    uint32_t _left {0};     // terms of the block
+
+    // at least bytes unread bytes in the buffer
+    const char *ensure(size_t bytes) {
+        if (_len - _at >= bytes) {
+            return &_buf[_at];
+        }
+        std::memmove(_buf.data(), _buf.data() + _at, _len - _at);
+        _len -= _at;
+        _at = 0;
+        _buf.resize(std::max(ReadBuffer, bytes));
+        while (_len < bytes) {
+            size_t want = std::min<uint64_t>(_buf.size() - _len, _end - _pos);
+            ssize_t got = want > 0 ? pread(_fd, _buf.data() + _len, want, _pos) : 0;
+            if (got <= 0) {
+                throw SpillError();
+            }
+            _len += got;
+            _pos += got;
+        }
+        return _buf.data();
+    }
+};
+
+// the buffer is only backed by memory as far as it is used
+SpilledExp::SpilledExp(size_t maxBytes, MonomialOrder order)
+    : _maxTerms(std::max<size_t>(maxBytes / BytesPerTerm, 1)),
+      _order(order == MonomialOrder::Input ? MonomialOrder::Lex : order)
+{
+    _buffer.numer.reserve(_maxTerms);
+}
+
+SpilledExp::~SpilledExp()
+{
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+// sorted, with every monomial once
+void SpilledExp::sortBuffer()
+{
+    BasicExp::Terms &terms = _buffer.numer;
+    _buffer.ExpSort(_order);
+    size_t kept = 0;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (kept > 0 && terms[kept - 1].monomial == terms[i].monomial) {
+            terms[kept - 1].rational = terms[kept - 1].rational + terms[i].rational;
+        } else {
+            if (kept != i) {
+                terms[kept] = std::move(terms[i]);
+            }
+            kept++;
+        }
+    }
+    while (terms.size() > kept) {
+        terms.pop_back();
+    }
+}
+
+void SpilledExp::spill()
+{
+    if (_buffer.numer.empty()) {
+        return;
+    }
+    checkDeadline(_buffer.numer.size());
+    if (_fd < 0) {
+        const char *dir = getenv("TMPDIR");
+        std::string path = std::string(dir != nullptr && *dir != '\0' ? dir : "/tmp") + "/plt-spill-XXXXXX";
+        _fd = mkstemp(&path[0]);
+        if (_fd < 0) {
+            throw SpillError();
+        }
+        unlink(path.c_str());
+    }
+    sortBuffer();
+
+    uint64_t begin = _size + _out.size();
+    PackedEncoder encoder;
+    const BasicExp::Terms &terms = _buffer.numer;
+    for (size_t i = 0; i < terms.size(); i += PackedExp::BlockTerms) {
+        uint32_t header[2] = {0, uint32_t(std::min<size_t>(PackedExp::BlockTerms, terms.size() - i))};
+        size_t at = _out.size();
+        _out.append(reinterpret_cast<const char*>(header), sizeof(header));
+        encoder.start();
+        for (uint32_t j = 0; j < header[1]; ++j) {
+            encoder.put(terms[i + j], _out);
+        }
+        header[0] = _out.size() - at - sizeof(header);
+        memcpy(&_out[at], header, sizeof(header));
+        if (_out.size() >= WriteBuffer) {
+            flush();
+        }
+    }
+    flush();
+    _runs.push_back(Run{begin, _size});
+    _stats.runs++;
+    _stats.spilledTerms += _buffer.numer.size();
+    _stats.spilledBytes = _size;
+    _buffer.numer.clear();
+}
+
+void SpilledExp::flush()
+{
+    size_t done = 0;
+    while (done < _out.size()) {
+        ssize_t n = pwrite(_fd, _out.data() + done, _out.size() - done, _size + done);
+        if (n <= 0) {
+            throw SpillError();
+        }
+        done += n;
+    }
+    _size += _out.size();
+    _out.clear();
+}
+
+void SpilledExp::write(std::ostream &os)
+{
+    bool first = true;
+    auto writeTerm = [this, &os, &first](BasicTerm &term) {
+        if (!first && term.rational.positive()) {
+            os << "+";
+        }
+        term.CodeGen(os);
+        first = false;
+        _stats.terms++;
+    };
+
+    if (_runs.empty()) {
+        sortBuffer();
+        for (BasicTerm &term : _buffer.numer) {
+            writeTerm(term);
+        }
+        _buffer.numer.clear();
+        return;
+    }
+    spill();
+    BasicExp().numer.swap(_buffer.numer);   // frees it
+
+    std::vector<Reader> readers;
+    readers.reserve(_runs.size());
+    std::vector<uint32_t> heap;
+    auto later = [this, &readers](uint32_t a, uint32_t b) {
+        return monomialBefore(readers[b].term.monomial, readers[a].term.monomial, _order);
+    };
+    for (const Run &run : _runs) {
+        readers.emplace_back(_fd, run);
+        if (readers.back().next()) {
+            heap.push_back(readers.size() - 1);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    BasicTerm cur(Rational(0, 1), Monomial());
+    bool have = false;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Reader &reader = readers[heap.back()];
+        if (have && cur.monomial == reader.term.monomial) {
+            cur.rational = cur.rational + reader.term.rational;
+        } else {
+            if (have) {
+                writeTerm(cur);
+            }
+            std::swap(cur, reader.term);
+            have = true;
+        }
+        if (reader.next()) {
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
+        }
+        checkDeadline(1);
+    }
+    if (have) {
+        writeTerm(cur);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef PLT_SPILL_H
+#define PLT_SPILL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iostream>
+#include "basic_exp.h"
+
+/* The terms of a result which does not fit in memory, collected on disk and written out
+ * in order without ever being in memory at once.
+ *
+ * put() collects the terms in a buffer of maxTerms() terms, as many as fit in maxBytes
+ * together with the scratch space of sorting them (BytesPerTerm). A full buffer is sorted
+ * (ExpSort), like terms are combined and it is appended to an unlinked temporary file in
+ * $TMPDIR (/tmp if it is not set) as a sorted run. write() merges the runs with a heap of
+ * one reader per run, combines like terms again as they meet and writes the CodeGen of
+ * every term as soon as it is complete, so the memory is maxBytes plus a ReadBuffer per
+ * run. All runs are in one file and are read with pread(), a single merge pass takes
+ * any number of them. If nothing was spilled the buffer is written directly.
+ *
+ * A run is a sequence of the blocks of packed_exp.h, each after its size in bytes and its
+ * number of terms as two uint32_t, in the ids of this process. The order is the one of
+ * ExpSort(), --order input has no order to merge by and gives Lex. Terms with the
+ * coefficient 0 are kept, as they are by the BasicExp operators.
+ */
+
+// a temporary file could not be created, written or read
+class SpillError : public std::exception {
+public:
+    const char *what() const noexcept override {return "spill failed";}
+};
+
+struct SpillStats {
+    size_t runs {0};
+    size_t spilledTerms {0};    // written to the runs, like terms of a buffer combined
+    size_t spilledBytes {0};
+    size_t terms {0};           // of the result
+};
+
+class SpilledExp {
+public:
+    static constexpr size_t WriteBuffer = size_t(1) << 20;
+    static constexpr size_t ReadBuffer = size_t(64) << 10;
+    // the term, its copy and radix keys in ExpSort()
+    static constexpr size_t BytesPerTerm = 4 * sizeof(BasicTerm);
+
+    SpilledExp(size_t maxBytes, MonomialOrder order);
+    ~SpilledExp();
+    SpilledExp(const SpilledExp &) = delete;
+    SpilledExp &operator=(const SpilledExp &) = delete;
+
+    void put(BasicTerm &&term) {
+        _buffer.numer.push_back(std::move(term));
+        if (_buffer.numer.size() >= _maxTerms) {
+            spill();
+        }
+    }
+
+    void write(std::ostream &os);   // can only be called once
+    size_t maxTerms() const {return _maxTerms;}
+    const SpillStats &stats() const {return _stats;}
+
+private:
+    struct Run {
+        uint64_t begin;
+        uint64_t end;
+    };
+    class Reader;
+
+    size_t _maxTerms;
+    MonomialOrder _order;
+    BasicExp _buffer;
+    int _fd {-1};
+    uint64_t _size {0};     // of the file
+    std::string _out;       // not yet written to the file
+    std::vector<Run> _runs;
+    SpillStats _stats;
+
+    void sortBuffer();
+    void spill();
+    void flush();
+};
+
+#endif
\ No newline at end of file
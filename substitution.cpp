@@ -0,0 +1,39 @@
+#include "substitution.h"
+#include "session.h"
+#include "error.h"
+
+thread_local const Bindings *activeBindings = nullptr;
+
+int Bindings::bind(const std::string &name, const std::string &value)
+{
+    if (SymbolTable::canonical(name).empty()) {
+        return Error::BadSymbol;
+    }
+    Session session;
+    int ret = session.simplify(value.data(), value.size());
+    if (ret != Error::Success) {
+        return ret;
+    }
+    bind(SymbolTable::global().intern(name), session.result());
+    return Error::Success;
+}
+
+// binding a symbol again replaces its value
+void Bindings::bind(uint32_t id, const BasicExp &value)
+{
+    if (id >= _slots.size()) {
+        _slots.resize(id + 1, -1);
+    }
+    if (_slots[id] >= 0) {
+        _values[_slots[id]] = value;
+        return;
+    }
+    _slots[id] = _values.size();
+    _values.push_back(value);
+}
+
+void Bindings::clear()
+{
+    _slots.clear();
+    _values.clear();
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef PLT_SUBSTITUTION_H
+#define PLT_SUBSTITUTION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "basic_exp.h"
+
+/* Symbols bound to values, e.g. a = 3 and b = \frac{1}{2}c, applied while an expression is
+ * evaluated instead of by editing its text.
+ *
+ * A BindingScope makes a set of bindings the one of the calling thread for its lifetime,
+ * SymbsAST::calc() and the PUSH_SYM of the Interpreter then push the value of a bound
+ * symbol in place of the symbol, so a number becomes part of the coefficients right at the
+ * leaf. The AST and the program are not changed, the same one can be evaluated with any
+ * number of binding sets. All bindings apply at once, the symbols of a value are not
+ * substituted again, and a value is used as if it was written in parentheses, so one which
+ * shares a symbol with the factor it is multiplied by is refused as a*a is.
+ */
+class Bindings {
+public:
+    // value is LaTeX, it is simplified without bindings, returns its error code
+    int bind(const std::string &name, const std::string &value);
+    void bind(uint32_t id, const BasicExp &value);
+    void clear();
+    bool empty() const {return _values.empty();}
+
+    // null if the symbol is not bound
+    const BasicExp *find(uint32_t id) const {
+        return id < _slots.size() && _slots[id] >= 0 ? &_values[_slots[id]] : nullptr;
+    }
+
+private:
+    std::vector<int32_t> _slots;    // index into _values by symbol id, -1 if not bound
+    std::vector<BasicExp> _values;
+};
+
+extern thread_local const Bindings *activeBindings;
+
+class BindingScope {
+public:
+    explicit BindingScope(const Bindings *bindings) : _saved(activeBindings) {
+        activeBindings = bindings != nullptr && !bindings->empty() ? bindings : nullptr;
+    }
+    ~BindingScope() {activeBindings = _saved;}
+    BindingScope(const BindingScope &) = delete;
+    BindingScope &operator=(const BindingScope &) = delete;
+
+private:
+    const Bindings *_saved;
+};
+
+// the value of the symbol in the running evaluation, null if it stays a symbol
+inline const BasicExp *boundValue(uint32_t id)
+{
+    return activeBindings != nullptr ? activeBindings->find(id) : nullptr;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <mutex>
+#include "symbol_table.h"
+#include "commands.h"
+
+static const char *greekNames[SymbolTable::Greeks] {
+    "\\alpha", "\\beta", "\\gamma", "\\delta", "\\epsilon", "\\zeta", "\\eta", "\\theta", "\\lota", "\\kappa",
+    "\\lambda", "\\mu", "\\nu", "\\xi", "\\omicron", "\\pi", "\\rho", "\\sigma", "\\tau", "\\upsilon", "\\phi",
+    "\\chi", "\\psi", "\\omega",
+};
+
+SymbolTable &SymbolTable::global()
+{
+    static SymbolTable table;
+    return table;
+}
+
+SymbolTable::SymbolTable()
+{
+    for (char c = 'a'; c <= 'z'; ++c) {
+        _names.push_back(std::string(1, c));
+    }
+    for (uint32_t i = 0; i < Greeks; ++i) {
+        _names.push_back(greekNames[i]);
+    }
+    _names.push_back("");
+    for (uint32_t id = 0; id <= Unknown; ++id) {
+        _ids.emplace(_names[id], id);
+        _fixed.push_back(_names[id]);
+    }
+}
+
+std::string SymbolTable::canonical(const std::string &name)
+{
+    size_t sub = name.find('_');
+    std::string base = name.substr(0, sub);
+    const Command *cmd = findCommand(base);
+    bool known = (base.size() == 1 && base[0] >= 'a' && base[0] <= 'z') || (cmd && cmd->kind == CommandKind::Symbol);
+    if (!known) {
+        return "";
+    }
+    if (sub == std::string::npos) {
+        return name;
+    }
+
+    // x_1 or x_{123}
+    std::string digits;
+    if (name.size() == sub + 2) {
+        digits = name.substr(sub + 1);
+    } else if (name.size() > sub + 3 && name[sub + 1] == '{' && name.back() == '}') {
+        digits = name.substr(sub + 2, name.size() - sub - 3);
+    }
+    if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) {
+        return "";
+    }
+    return base + "_{" + digits + "}";
+}
+
+uint32_t SymbolTable::intern(const std::string &name)
+{
+    if (name.size() == 1) {
+        return name[0] - 'a';
+    }
+    std::string key = canonical(name);
+    if (key.empty()) {
+        return Unknown;
+    }
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto it = _ids.find(key);
+        if (it != _ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    auto it = _ids.find(key);
+    if (it != _ids.end()) {
+        return it->second;
+    }
+    uint32_t id = _names.size();
+    _names.push_back(key);
+    _ids.emplace(key, id);
+    return id;
+}
+
+int SymbolTable::find(const std::string &name) const
+{
+    std::string key = canonical(name);
+    if (key.empty()) {
+        return -1;
+    }
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    auto it = _ids.find(key);
+    return it == _ids.end() ? -1 : int(it->second);
+}
+
+// the strings never move, only looking them up needs the lock
+const std::string &SymbolTable::name(uint32_t id) const
+{
+    if (id <= Unknown) {
+        return _fixed[id];
+    }
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _names[id];
+}
+
+uint32_t SymbolTable::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _names.size();
+}
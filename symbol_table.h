@@ -0,0 +1,46 @@
+#ifndef PLT_SYMBOL_TABLE_H
+#define PLT_SYMBOL_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+
+/* Interned symbol names, every name gets an id on first use which it keeps for the lifetime
+ * of the process. a-z and the greek letters have the fixed ids 0-49, so they keep their
+ * order. Texts which are no symbols (left over by lexer errors) all share the id Unknown
+ * with an empty name. Subscripted symbols (x_{1}, \alpha_{12}) and the other greek letters
+ * of commands.h (\Gamma, \varphi) get the next free ids.
+ *
+ * There is one table, shared by all sessions and threads. Looking up one of the fixed
+ * symbols takes no lock.
+ */
+class SymbolTable {
+public:
+    static constexpr uint32_t Letters = 26;
+    static constexpr uint32_t Greeks = 24;
+    static constexpr uint32_t FixedSymbols = Letters + Greeks;
+    static constexpr uint32_t Unknown = FixedSymbols;    // id of every name which is no symbol
+
+    static SymbolTable &global();
+
+    // the canonical spelling of name, "x_1" -> "x_{1}", or "" if it is no symbol
+    static std::string canonical(const std::string &name);
+
+    uint32_t intern(const std::string &name);
+    int find(const std::string &name) const;    // -1 if name is no symbol or was never interned
+    const std::string &name(uint32_t id) const;
+    uint32_t size() const;
+
+private:
+    SymbolTable();
+
+    mutable std::shared_mutex _mutex;
+    std::deque<std::string> _names;     // references stay valid while it grows
+    std::vector<std::string> _fixed;    // the names of the fixed ids, never changed
+    std::unordered_map<std::string, uint32_t> _ids;
+};
+
+#endif
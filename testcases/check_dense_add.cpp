@@ -0,0 +1,107 @@
+// the dense add and subtract of basic_exp.cpp against the scan they replace, and the reuse
+// of their index after a budget abort, run by `make check`
+#include <cstdio>
+#include <random>
+#include "session.h"
+
+// the scan of operator+ before the dense index
+static BasicExp scanAdd(const BasicExp &expA, const BasicExp &expB, bool subtract)
+{
+    BasicExp res = expA;
+    for (const BasicTerm &term : expB.numer) {
+        size_t i = 0;
+        for ( ; i < expA.numer.size(); ++i) {
+            if (expA.numer[i].monomial == term.monomial) {
+                res.numer[i].rational = subtract ? expA.numer[i].rational - term.rational : expA.numer[i].rational + term.rational;
+                break;
+            }
+        }
+        if (i == expA.numer.size()) {
+            res.numer.push_back(subtract ? -term : term);
+        }
+    }
+    return res;
+}
+
+static bool same(const BasicExp &expA, const BasicExp &expB)
+{
+    if (expA.numer.size() != expB.numer.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < expA.numer.size(); ++i) {
+        const BasicTerm &termA = expA.numer[i], &termB = expB.numer[i];
+        if (!(termA.monomial == termB.monomial) || termA.rational.numer != termB.rational.numer ||
+            termA.rational.denom != termB.rational.denom) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// terms over k symbols, distinct monomials in a random order
+static BasicExp randomExp(std::mt19937 &rng, uint32_t k, size_t terms)
+{
+    std::vector<uint32_t> subsets(size_t(1) << k);
+    for (uint32_t i = 0; i < subsets.size(); ++i) {
+        subsets[i] = i;
+    }
+    std::shuffle(subsets.begin(), subsets.end(), rng);
+    BasicExp exp;
+    for (size_t i = 0; i < terms && i < subsets.size(); ++i) {
+        Monomial mono;
+        for (uint32_t id = 0; id < k; ++id) {
+            if (subsets[i] >> id & 1) {
+                mono.insert(id);
+            }
+        }
+        exp.numer.push_back(BasicTerm(Rational(int(rng() % 19) - 9, rng() % 3 == 0 ? 2 : 1), mono));
+    }
+    return exp;
+}
+
+static int checkRandom()
+{
+    std::mt19937 rng(4115);
+    for (int n = 0; n < 3000; ++n) {
+        uint32_t k = 3 + rng() % 10;
+        BasicExp expA = randomExp(rng, k, 1 + rng() % 300), expB = randomExp(rng, k, 1 + rng() % 300);
+        bool subtract = rng() % 2;
+        BasicExp res = subtract ? expA - expB : expA + expB;
+        if (!same(res, scanAdd(expA, expB, subtract))) {
+            printf("FAIL dense add: sum %d over %u symbols, %zu and %zu terms\n", n, k, expA.numer.size(),
+                   expB.numer.size());
+            return 1;
+        }
+    }
+    printf("ok   dense add: 3000 random sums\n");
+    return 0;
+}
+
+// an abort in the middle of an add must not leave positions in the index of the thread
+static int checkBudgetAbort()
+{
+    Session session;
+    Budget budget;
+    budget.maxCoefficientBits = 11;
+    session.setBudget(budget);
+    std::string text = "1000*(1+a)*(1+b)*(1+c)*(1+d)*(1+e)+1100*(1+a)*(1+b)*(1+c)*(1+d)*(1+e)";
+    int ret = session.simplify(text.c_str(), text.size());
+    if (ret != Error::CoefficientTooLarge) {
+        printf("FAIL dense add after a budget abort: the budget returned %d\n", ret);
+        return 1;
+    }
+    session.setBudget(Budget());
+    text = "(1+a)*(1+b)*(1+c)*(1+d)+(1+a)*(1+b)*(1+c)*(1+d)*(1+e)";
+    ret = session.simplify(text.c_str(), text.size());
+    if (ret != Error::Success || session.result().numer.size() != 32) {
+        printf("FAIL dense add after a budget abort: %zu terms instead of 32\n", session.result().numer.size());
+        return 1;
+    }
+    printf("ok   dense add after a budget abort\n");
+    return 0;
+}
+
+int main()
+{
+    return checkRandom() | checkBudgetAbort();
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#!/bin/sh
+# compiles the --emit-c function of every expression and compares its values with --eval-points
+# at random points, run by `make check`
+MAIN=${MAIN:-./main}
+CC=${CC:-cc}
+POINTS=300      # more than one block of eval.h
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+check() {
+    # a syntax error is printed with the usage and exit code 0
+    "$MAIN" -s "$1" --emit-c f > "$TMP/f.c" && grep -q '^double f(' "$TMP/f.c" ||
+        { printf 'FAIL %s: --emit-c\n' "$1"; return 1; }
+    # the parameters back to the names of the symbols: alpha_1 is \alpha_{1}
+    params=$(sed -n 's/^double f(\(.*\))$/\1/p' "$TMP/f.c" | sed 's/double //g; s/,//g; s/^void$//')
+    header=$(for p in $params; do
+        base=${p%%_*}
+        [ ${#base} -gt 1 ] && base="\\$base"
+        case $p in
+            *_*) printf '%s_{%s} ' "$base" "${p#*_}";;
+            *) printf '%s ' "$base";;
+        esac
+    done)
+    n=$(echo $params | wc -w)
+    printf '%s\n' "$header" > "$TMP/points.txt"
+    awk -v n=$n -v points=$POINTS 'BEGIN {
+        srand(4115);
+        for (i = 0; i < points; i++) {
+            line = "";
+            for (j = 0; j < n; j++) line = line sprintf("%s%.3f", j ? " " : "", rand() * 4 - 2);
+            print line;
+        }
+    }' >> "$TMP/points.txt"
+
+    # a main reading the same table, the header is skipped
+    args=$(awk -v n=$n 'BEGIN {for (j = 0; j < n; j++) printf "%sv[%d]", j ? ", " : "", j}')
+    {
+        printf '#include <stdio.h>\n#include <stdlib.h>\n'
+        cat "$TMP/f.c"
+        cat <<END
+int main(void)
+{
+    double v[$n + 1];
+    char line[4096];
+    if (!fgets(line, sizeof(line), stdin)) {
+        return 1;
+    }
+    while (fgets(line, sizeof(line), stdin)) {
+        char *p = line;
+        for (int j = 0; j < $n; ++j) {
+            v[j] = strtod(p, &p);
+        }
+        printf("%.17g\\n", f($args));
+    }
+    return 0;
+}
+END
+    } > "$TMP/driver.c"
+    "$CC" -O2 -o "$TMP/driver" "$TMP/driver.c" || { printf 'FAIL %s: cc\n' "$1"; return 1; }
+
+    "$MAIN" -s "$1" --eval-points "$TMP/points.txt" > "$TMP/expected.txt" || { printf 'FAIL %s: --eval-points\n' "$1"; return 1; }
+    "$TMP/driver" < "$TMP/points.txt" > "$TMP/actual.txt"
+    # the horner form rounds differently from the expanded terms
+    paste "$TMP/expected.txt" "$TMP/actual.txt" | awk -v points=$POINTS '
+        {
+            d = $1 - $2; d = d < 0 ? -d : d;
+            m = $1 < 0 ? -$1 : $1; m = m < 1 ? 1 : m;
+            if (NF != 2 || d > 1e-9 * m) {bad++; if (bad == 1) print "  point " NR ": " $1 " != " $2}
+        }
+        END {exit bad > 0 || NR != points}' || { printf 'FAIL %s\n' "$1"; return 1; }
+    printf 'ok   %s\n' "$1"
+}
+
+fail=0
+for tex in testcases/test0.tex testcases/test4.tex testcases/test5.tex testcases/test6.tex; do
+    check "$(cat "$tex")" || fail=1
+done
+for exp in '3' 'a-a' '\frac{1}{2}ab+\frac{1}{3}ac+2b' '(a+b)*(c-d)*(e+f)*\alpha' \
+           '(x_{1}+x_{2}+\beta_{1})*(y-2)*(\frac{1}{7}+z)' '-(a+b+c)*(d+e+f)*(g+h+i)'; do
+    check "$exp" || fail=1
+done
+exit $fail
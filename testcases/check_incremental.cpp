@@ -0,0 +1,103 @@
+// random edits of an IncrementalSession against a full Session::simplify() of its text():
+// the same error code and, without an error, the same terms, run by `make check`
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "incremental.h"
+#include "session.h"
+
+// an operator and an operand, or a piece which breaks the input most of the time
+static std::string randomSnippet(std::mt19937 &rng)
+{
+    static const char *Ops[] = {"+", "-", "*", ""};
+    static const char *Pieces[] = {"(", ")", "{", "}", "\\frac{", "}{", "\\", "_", " ", "2", "/"};
+    if (rng() % 4 == 0) {
+        return Pieces[rng() % (sizeof(Pieces) / sizeof(Pieces[0]))];
+    }
+    std::string res = Ops[rng() % 4];
+    char symbol = char('a' + rng() % 26);
+    switch (rng() % 6) {
+    case 0:
+        return res + std::to_string(rng() % 20);
+    case 1:
+        return res + "\\frac{" + std::to_string(1 + rng() % 9) + "}{" + std::to_string(1 + rng() % 9) + "}";
+    case 2:
+        return res + "(" + symbol + "+" + std::to_string(rng() % 5) + ")";
+    case 3:
+        return res + "\\alpha";
+    case 4:
+        return res + symbol + "_{" + std::to_string(rng() % 3) + "}";
+    default:
+        return res + symbol;
+    }
+}
+
+// the terms in Lex order, as the Session puts them
+static std::string sorted(const BasicExp &exp)
+{
+    BasicExp copy = exp;
+    copy.ExpSort(MonomialOrder::Lex);
+    std::ostringstream os;
+    copy.CodeGen(os);
+    return os.str();
+}
+
+int main()
+{
+    const int Edits = 200000;
+    // the lexer of the session prints the errors of its full runs, which are expected here
+    fflush(stdout);
+    int out = dup(1), null = open("/dev/null", O_WRONLY);
+    dup2(null, 1);
+
+    std::mt19937 rng(4115);
+    IncrementalSession inc;
+    Session session;
+    int valid = 0, fail = 0;
+    std::string message;
+    for (int n = 0; n < Edits && !fail; ++n) {
+        std::string before = inc.text();
+        uint32_t offset = 0, removed = 0;
+        std::string inserted;
+        int ret = 0;
+        if (n % 1000 == 0 || before.size() > 150) {
+            ret = inc.load("(a+b)*\\frac{1}{2}c - 3d + \\frac{e}{4}");
+        } else {
+            offset = rng() % (before.size() + 1);
+            removed = std::min<uint32_t>(rng() % 6, before.size() - offset);
+            inserted = randomSnippet(rng);
+            ret = inc.edit(offset, removed, inserted);
+        }
+        // every edit is checked, also the ones which take the text back
+        for (int undo = 0; undo < 2 && !fail; ++undo) {
+            const std::string &text = inc.text();
+            int full = session.simplify(text.data(), text.size());
+            if (ret != full || (ret == Error::Success && sorted(inc.result()) != sorted(session.result()))) {
+                message = "edit " + std::to_string(n) + " to \"" + text + "\" returned " + std::to_string(ret) +
+                          ", a full run " + std::to_string(full);
+                fail = 1;
+            }
+            valid += ret == Error::Success;
+            // most broken texts are taken back, so that the next edit starts from a valid one
+            if (ret == Error::Success || rng() % 4 == 0) {
+                break;
+            }
+            ret = inc.edit(offset, inserted.size(), before.substr(offset, removed));
+        }
+    }
+
+    std::cout.flush();
+    fflush(stdout);
+    dup2(out, 1);
+    close(out);
+    close(null);
+    if (fail) {
+        printf("FAIL incremental: %s\n", message.c_str());
+        return 1;
+    }
+    printf("ok   incremental: %d random edits, %d valid texts\n", Edits, valid);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+// the tokenize() of a buffer, which takes runs at once (char_scan.h), against the one of a
+// file, which feeds the fsm one readChar() per byte, with every scan implementation the cpu
+// has: the tokens, their positions and the errors must be the same, run by `make check`
+#include <cstdio>
+#include <string_view>
+#include <fstream>
+#include <random>
+#include <unistd.h>
+#include "lexer.h"
+#include "char_scan.h"
+
+static const std::string_view Pieces[] = {
+    "\\frac", "\\dfrac", "\\alpha", "\\beta", "\\cdot", "\\times", "\\div", "\\left(", "\\right)",
+    "\\Gamma", "\\varphi", "\\bad", "\\", "+", "-", "*", "/", "(", ")", "{", "}", "_", "_{12}", "_1",
+    "_{a}", "^", "#", ".", ":", "A", "\x80", "\xff", "\t", "\n", std::string_view("\0", 1),
+};
+
+// runs long enough for the 16 and 32 byte steps, mixed with everything the fsm knows
+static std::string randomInput(std::mt19937 &rng)
+{
+    std::string input;
+    for (int pieces = rng() % 24; pieces > 0; --pieces) {
+        size_t run = 1 + rng() % (rng() % 4 == 0 ? 70 : 6);
+        switch (rng() % 6) {
+        case 0:
+            for (size_t i = 0; i < run; ++i) {
+                input.push_back(char('0' + rng() % 10));
+            }
+            break;
+        case 1:
+            for (size_t i = 0; i < run; ++i) {
+                input.push_back(char('a' + rng() % 26));
+            }
+            break;
+        case 2:
+            input.append(run, rng() % 8 == 0 ? '\t' : ' ');
+            break;
+        default:
+            input.append(Pieces[rng() % (sizeof(Pieces) / sizeof(Pieces[0]))]);
+            break;
+        }
+    }
+    return input;
+}
+
+int main()
+{
+    char path[] = "/tmp/check_lexer.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAIL lexer: no temporary file\n");
+        return 1;
+    }
+    close(fd);
+
+    int fail = 0;
+    for (const char *impl : {"avx2", "sse2", "scalar"}) {
+        if (!setScanImpl(impl)) {
+            printf("skip lexer with %s: not supported by the cpu\n", impl);
+            continue;
+        }
+        std::mt19937 rng(4115);
+        int n = 0;
+        for ( ; n < 20000; ++n) {
+            std::string input = randomInput(rng);
+            std::ofstream(path, std::ios::binary | std::ios::trunc) << input;
+
+            Lexer scanned, fsm;
+            scanned.setQuiet(true);
+            fsm.setQuiet(true);
+            int retScanned = scanned.tokenize(input.data(), input.size());
+            std::ifstream file(path, std::ios::binary);
+            int retFsm = fsm.tokenize(file);
+            if (retScanned != retFsm || scanned.getLexError() != fsm.getLexError() ||
+                scanned.getStream() != fsm.getStream() || scanned.getPositions() != fsm.getPositions()) {
+                printf("FAIL lexer with %s: input %d \"%s\"\n", impl, n, input.c_str());
+                fail = 1;
+                break;
+            }
+        }
+        if (n == 20000) {
+            printf("ok   lexer with %s: 20000 random inputs\n", impl);
+        }
+    }
+    unlink(path);
+    return fail;
+}
\ No newline at end of file